@@ -3,7 +3,11 @@
 #include "json5_base.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
 #include <string>
 #include <vector>
 
@@ -18,7 +22,7 @@ class value
 {
 public:
 	// Construct null value
-	value() noexcept = default;
+	value() noexcept : _data( type_null ) { }
 
 	// Construct null value
 	value( std::nullptr_t ) noexcept : _data( type_null ) { }
@@ -47,7 +51,7 @@ public:
 	// Checks, if value stores number. Use 'get' or 'try_get' for reading.
 	bool is_number() const noexcept { return ( _data & mask_nanbits ) != mask_nanbits; }
 
-	// Checks, if value stores string. Use 'get_c_str' for reading.
+	// Checks, if value stores string. Use 'get_c_str' or 'get_string_view' for reading.
 	bool is_string() const noexcept { return ( _data & mask_type ) == type_string; }
 
 	// Checks, if value stores JSON object. Use 'object_view' wrapper
@@ -64,6 +68,10 @@ public:
 	// Get stored string. Returns 'defaultValue', if this value is not a string.
 	const char *get_c_str( const char *defaultValue = "" ) const noexcept;
 
+	// Get stored string including its length (O(1), may contain '\0' chars). Returns 'defaultValue',
+	// if this value is not a string.
+	std::string_view get_string_view( std::string_view defaultValue = std::string_view() ) const noexcept;
+
 	// Get stored number as type 'T'. Returns 'defaultValue', if this value is not a number.
 	template <typename T>
 	T get( T defaultValue = 0 ) const noexcept
@@ -82,17 +90,25 @@ public:
 		return true;
 	}
 
-	// Equality test against another value. Note that this might be a very expensive operation
-	// for large nested JSON objects!
+	// Equality test against another value. Objects and arrays with different structural hashes
+	// are rejected in O(1), equal ones are compared recursively.
 	bool operator==( const value &other ) const noexcept;
 
 	// Non-equality test
 	bool operator!=( const value &other ) const noexcept { return !( ( *this ) == other ); }
 
+	// Get 64-bit structural hash. Equal values have equal hashes (order of object keys does not
+	// matter). Hashes of objects and arrays are computed when they are built, so this is O(1),
+	// unless the document was edited by json5::editor (then they are recomputed until 'compact').
+	uint64_t hash() const noexcept;
+
 	// Use value as JSON object and get property value under 'key'. If this value
 	// is not an object or 'key' is not found, null value is always returned.
 	value operator[]( std::string_view key ) const noexcept;
 
+	// Same as above, but checks position of the last match of 'k' first (see json5::key)
+	value operator[]( const key &k ) const noexcept;
+
 	// Use value as JSON array and get item at 'index'. If this value is not
 	// an array or index is out of bounds, null value is returned.
 	value operator[]( size_t index ) const noexcept;
@@ -104,8 +120,6 @@ protected:
 	value( value_type t, uint64_t data );
 	value( value_type t, const void *data ) : value( t, reinterpret_cast<uint64_t>( data ) ) { }
 
-	void relink( const class document *prevDoc, const class document &doc ) noexcept;
-
 	// NaN-boxed data
 	union
 	{
@@ -129,8 +143,118 @@ protected:
 	// Stores lower 48bits of a pointer as payload
 	void payload( const void *p ) noexcept { payload( reinterpret_cast<uint64_t>( p ) ); }
 
-	friend document;
+	/*
+		Values stored in a document reference strings and containers by offsets into document's
+		buffers, so the buffers can be moved or copied without touching their contents. Views
+		resolve these offsets into pointers, when handing the values out:
+
+		- '_values[0]' is the document base slot, it stores distance from '_values' to '_strings'
+		- '_values[1]' stores document flags
+		- containers start with a header: number of element slots, header index (distance
+		  back to the document base slot) and structural hash, followed by the elements
+		- large objects have a hash index right in front of their header
+		- header of a container moved by json5::editor stores reference to the new header
+		  in place of the number of element slots, the new header stores its capacity in place
+		  of the structural hash (hashes of edited documents are stale)
+	*/
+	static constexpr size_t base_size = 2;
+	static constexpr size_t header_size = 3;
+
+	// Document flag: cached structural hashes in container headers are out of date
+	static constexpr uint64_t flag_stale_hashes = 1;
+
+	// Document flags: containers are not stored in post-order, or are stored in pre-order or
+	// breadth-first (containers added later by builder make the document mixed, see 'builder::pop')
+	static constexpr uint64_t flag_not_post_order = 2;
+	static constexpr uint64_t flag_pre_order = 4;
+	static constexpr uint64_t flag_breadth_first = 8;
+	static constexpr uint64_t flags_layout = flag_not_post_order | flag_pre_order | flag_breadth_first;
+
+	// Document flag: some object has duplicate keys, so positions cached by json5::key are not used
+	// (those could point at a later duplicate than the first one, which lookups by string find)
+	static constexpr uint64_t flag_duplicate_keys = 16;
+
+	// Get document base slot of a container
+	static const value *base_of( const value *header ) noexcept { return header - header[1].get<size_t>(); }
+
+	// Get current header of a container (follows references left by moved containers)
+	static const value *header_of( const value &container ) noexcept
+	{
+		const value *header = container.payload<const value *>();
+		while ( !header[0].is_number() )
+			header = base_of( header ) + header[0].payload<size_t>();
+
+		return header;
+	}
+
+	// Get number of hash index slots in front of an object with 'count' key-value pairs
+	static size_t index_size( size_t count ) noexcept
+	{
+		return ( count >= detail::object_index_threshold ) ? detail::object_index_capacity( count ) / 2 : 0;
+	}
+
+	// Get string buffer of a document from its base slot
+	static const char *strings_of( const value *base ) noexcept
+	{
+		return reinterpret_cast<const char *>( reinterpret_cast<uintptr_t>( base ) + base->_data );
+	}
+
+	// Convert stored value (with offsets) into value with pointers
+	value resolve( const value *base, const char *strings ) const noexcept
+	{
+		value result = *this;
+
+		if ( is_string() )
+			result.payload( strings + payload<size_t>() );
+		else if ( is_object() || is_array() )
+			result.payload( base + payload<size_t>() );
+
+		return result;
+	}
+
+	// Read length prefix of a string stored in document's string buffer
+	static size_t string_length( const char *str ) noexcept
+	{
+		detail::string_length result;
+		memcpy( &result, str - sizeof( result ), sizeof( result ) );
+		return result;
+	}
+
+	// Seeds of structural hashes per value type
+	static constexpr uint64_t hash_seed_null   = 0x6e756c6c00000000ull;
+	static constexpr uint64_t hash_seed_bool   = 0x626f6f6c00000000ull;
+	static constexpr uint64_t hash_seed_string = 0x7374720000000000ull;
+	static constexpr uint64_t hash_seed_array  = 0x6172720000000000ull;
+	static constexpr uint64_t hash_seed_object = 0x6f626a0000000000ull;
+
+	// Compute structural hash of container elements
+	static uint64_t hash_elements( bool isObject, const value *elements, size_t count, const value *base, const char *strings ) noexcept;
+
+	// Checks, if cached structural hash of a container can be used
+	bool has_cached_hash() const noexcept { return !( base_of( header_of( *this ) )[1]._data & flag_stale_hashes ); }
+
+	// Object hash index entries (1-based pair indices) are packed two per value slot
+	static uint32_t index_entry( const value *table, size_t i ) noexcept { return uint32_t( table[i / 2]._data >> ( ( i & 1 ) * 32 ) ); }
+	static void index_entry( value *table, size_t i, uint32_t e ) noexcept { table[i / 2]._data |= uint64_t( e ) << ( ( i & 1 ) * 32 ); }
+
+	// Add key-value pair 'pairIndex' into hash index of an object with 'count' pairs
+	static void index_add( value *table, size_t count, std::string_view key, size_t pairIndex ) noexcept;
+
+	// Fill hash index of an object with 'count' key-value pairs. Returns true, if some key repeats.
+	static bool index_build( value *table, const value *pairs, size_t count, const char *strings ) noexcept;
+
+	// Checks, if some key of an object with 'count' key-value pairs repeats (for objects without
+	// hash index, those with one are checked by 'index_build')
+	static bool has_duplicate_keys( const value *pairs, size_t count, const char *strings ) noexcept;
+
+	friend array_view;
 	friend builder;
+	friend compact_document;
+	friend document;
+	friend editor;
+	friend object_view;
+	friend detail::snapshot;
+	friend detail::statistics;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -146,28 +270,94 @@ public:
 	// Construct empty document
 	document() = default;
 
+	// Construct empty document, which allocates its buffers from memory 'resource'
+	explicit document( std::pmr::memory_resource *resource ) noexcept : _strings( resource ), _values( resource ) { }
+
 	// Construct a document copy
 	document( const document &copy ) { assign_copy( copy ); }
 
-	// Construct a document from r-value
-	document( document &&rValue ) noexcept { assign_rvalue( std::forward<document>( rValue ) ); }
+	// Construct a document copy, which allocates its buffers from memory 'resource'
+	document( const document &copy, std::pmr::memory_resource *resource ) : _strings( resource ), _values( resource ) { assign_copy( copy ); }
+
+	// Construct a document from r-value (takes over its memory resource)
+	document( document &&rValue ) noexcept
+		: _strings( rValue._strings.get_allocator() ), _values( rValue._values.get_allocator() )
+	{
+		assign_rvalue( std::forward<document>( rValue ) );
+	}
 
 	// Copy data from another document (does a deep copy)
 	document &operator=( const document &copy ) { assign_copy( copy ); return *this; }
 
-	// Assign data from r-value (does a swap)
-	document &operator=( document &&rValue ) noexcept { assign_rvalue( std::forward<document>( rValue ) ); return *this; }
+	// Assign data from r-value. Buffers are taken over, when both documents use the same memory
+	// resource, otherwise they are copied (which allocates and may throw)
+	document &operator=( document &&rValue ) { assign_rvalue( std::forward<document>( rValue ) ); return *this; }
+
+	// Get memory resource used for document buffers
+	std::pmr::memory_resource *resource() const noexcept { return _values.get_allocator().resource(); }
+
+	// Get number of bytes reserved by document buffers
+	size_t reserved_bytes() const noexcept { return _strings.capacity() + _values.capacity() * sizeof( value ); }
+
+	// Reset document to null value, allocated buffers are kept for reuse
+	void clear() noexcept { _data = type_null; _strings.clear(); _values.clear(); }
+
+	// Checks, if containers are stored in 'order' (documents edited in place or combined from
+	// blocks with different layouts are in no particular order until 'editor::compact')
+	bool has_layout( layout order ) const noexcept;
 
 private:
 	void assign_copy( const document &copy );
-	void assign_rvalue( document &&rValue ) noexcept;
+	void assign_rvalue( document &&rValue );
 	void assign_root( value root ) noexcept;
+	void update_base() noexcept;
 
-	std::string _strings;
-	std::vector<value> _values;
+	std::pmr::string _strings;
+	std::pmr::vector<value> _values;
 
 	friend value;
 	friend builder;
+	friend compact_document;
+	friend editor;
+	friend detail::snapshot;
+	friend detail::statistics;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::key
+
+Object key, which remembers the position of its last match. Objects with the same key order
+(e.g. records in an array) have the key at the same position, so lookups of a key reused across
+them check one pair instead of searching the object. The key string is not copied and must outlive
+the key. Hash of the key is computed once too, for lookups in large objects (with hash index).
+Documents with duplicate keys are searched every time, so the first match is found, the same as
+by lookups with a string. The cached position is a relaxed atomic, so keys (and json5::pointer)
+can be shared by threads, but threads reading objects of different layouts overwrite each other's
+position, so hot keys are better kept per thread.
+
+*/
+class key final
+{
+public:
+	explicit key( std::string_view name ) noexcept : _name( name ), _hash( detail::hash_key( name ) ) { }
+
+	key( const key &copy ) noexcept : _name( copy._name ), _hash( copy._hash ), _index( copy.cached_index() ) { }
+	key &operator=( const key &copy ) noexcept;
+
+	std::string_view name() const noexcept { return _name; }
+
+private:
+	size_t cached_index() const noexcept { return _index.load( std::memory_order_relaxed ); }
+	void cached_index( size_t index ) const noexcept { _index.store( index, std::memory_order_relaxed ); }
+
+	std::string_view _name;
+	uint64_t _hash = 0;
+	mutable std::atomic<size_t> _index{ size_t( -1 ) };
+
+	friend object_view;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -185,10 +375,7 @@ public:
 
 	// Construct object view over a value. If the provided value does not reference a JSON object,
 	// this object_view will be created empty (and invalid)
-	object_view( const value &v ) noexcept
-		: _pair( v.is_object() ? ( v.payload<const value*>() + 1 ) : nullptr )
-		, _count( _pair ? ( _pair[-1].get<size_t>() / 2 ) : 0 )
-	{ }
+	object_view( const value &v ) noexcept;
 
 	// Checks, if object view was constructed from valid value
 	bool is_valid() const noexcept { return _pair != nullptr; }
@@ -198,37 +385,68 @@ public:
 	class iterator final
 	{
 	public:
-		iterator( const value *p = nullptr ) noexcept : _pair( p ) { }
+		iterator( const value *p = nullptr, const value *base = nullptr, const char *strings = nullptr ) noexcept
+			: _pair( p ), _base( base ), _strings( strings ) { }
+
 		bool operator!=( const iterator &other ) const noexcept { return _pair != other._pair; }
 		bool operator==( const iterator &other ) const noexcept { return _pair == other._pair; }
 		iterator &operator++() noexcept { _pair += 2; return *this; }
-		key_value_pair operator*() const noexcept { return key_value_pair( _pair[0].get_c_str(), _pair[1] ); }
+
+		key_value_pair operator*() const noexcept
+		{
+			return key_value_pair( _strings + _pair[0].payload<size_t>(), _pair[1].resolve( _base, _strings ) );
+		}
 
 	private:
 		const value *_pair = nullptr;
+		const value *_base = nullptr;
+		const char *_strings = nullptr;
 	};
 
 	// Get an iterator to the beginning of the object (first key-value pair)
-	iterator begin() const noexcept { return iterator( _pair ); }
+	iterator begin() const noexcept { return iterator( _pair, _base, _strings ); }
 
 	// Get an iterator to the end of the object (past the last key-value pair)
-	iterator end() const noexcept { return iterator( _pair + _count * 2 ); }
+	iterator end() const noexcept { return iterator( _pair + _count * 2, _base, _strings ); }
 
 	// Find property value with 'key'. Returns end iterator, when not found.
 	iterator find( std::string_view key ) const noexcept;
+	iterator find( const key &k ) const noexcept;
 
 	// Get number of key-value pairs
 	size_t size() const noexcept { return _count; }
 
 	bool empty() const noexcept { return size() == 0; }
 	value operator[]( std::string_view key ) const noexcept;
+	value operator[]( const key &k ) const noexcept;
 
 	bool operator==( const object_view &other ) const noexcept;
 	bool operator!=( const object_view &other ) const noexcept { return !( ( *this ) == other ); }
 
 private:
+	std::string_view key_at( const value *pair ) const noexcept
+	{
+		const char *str = _strings + pair->payload<size_t>();
+		return std::string_view( str, value::string_length( str ) );
+	}
+
+	// Get index of key-value pair with 'key' (or 'size()', when not found)
+	size_t index_of( std::string_view key ) const noexcept;
+	size_t index_of( std::string_view key, uint64_t hash ) const noexcept;
+	size_t index_of( const key &k ) const noexcept;
+
+	// Checks, if keys of pairs from 'first' to the end are not used by any other pair
+	bool has_unique_keys( const value *first ) const noexcept;
+
+	// Get number of pairs from 'first' to the end, which are equal to 'key': 'v'
+	size_t count_pairs( const value *first, std::string_view key, const value &v ) const noexcept;
+
 	const value *_pair = nullptr;
 	size_t _count = 0;
+	const value *_base = nullptr;
+	const char *_strings = nullptr;
+
+	friend editor;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -246,18 +464,63 @@ public:
 
 	// Construct array view over a value. If the provided value does not reference a JSON array,
 	// this array_view will be created empty (and invalid)
-	array_view( const value &v ) noexcept
-		: _value( v.is_array() ? ( v.payload<const value*>() + 1 ) : nullptr )
-		, _count( _value ? _value[-1].get<size_t>() : 0 )
-	{ }
+	array_view( const value &v ) noexcept;
 
 	// Checks, if array view was constructed from valid value
 	bool is_valid() const noexcept { return _value != nullptr; }
 
-	using iterator = const value*;
+	/*
+		Random access iterator, which resolves stored elements into values on access. Elements are
+		returned by value, so 'operator->' returns a proxy holding the resolved value.
+	*/
+	class iterator final
+	{
+	public:
+		struct arrow_proxy
+		{
+			value resolved;
+			const value *operator->() const noexcept { return &resolved; }
+		};
+
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = value;
+		using difference_type = std::ptrdiff_t;
+		using pointer = arrow_proxy;
+		using reference = value;
+
+		iterator( const value *p = nullptr, const value *base = nullptr, const char *strings = nullptr ) noexcept
+			: _value( p ), _base( base ), _strings( strings ) { }
+
+		bool operator!=( const iterator &other ) const noexcept { return _value != other._value; }
+		bool operator==( const iterator &other ) const noexcept { return _value == other._value; }
+		bool operator<( const iterator &other ) const noexcept { return _value < other._value; }
+		bool operator>( const iterator &other ) const noexcept { return _value > other._value; }
+		bool operator<=( const iterator &other ) const noexcept { return _value <= other._value; }
+		bool operator>=( const iterator &other ) const noexcept { return _value >= other._value; }
+
+		iterator &operator++() noexcept { ++_value; return *this; }
+		iterator &operator--() noexcept { --_value; return *this; }
+		iterator operator++( int ) noexcept { iterator result = *this; ++_value; return result; }
+		iterator operator--( int ) noexcept { iterator result = *this; --_value; return result; }
+		iterator &operator+=( difference_type n ) noexcept { _value += n; return *this; }
+		iterator &operator-=( difference_type n ) noexcept { _value -= n; return *this; }
+		iterator operator+( difference_type n ) const noexcept { return iterator( _value + n, _base, _strings ); }
+		iterator operator-( difference_type n ) const noexcept { return iterator( _value - n, _base, _strings ); }
+		friend iterator operator+( difference_type n, const iterator &iter ) noexcept { return iter + n; }
+		difference_type operator-( const iterator &other ) const noexcept { return _value - other._value; }
+
+		value operator*() const noexcept { return _value->resolve( _base, _strings ); }
+		value operator[]( difference_type n ) const noexcept { return _value[n].resolve( _base, _strings ); }
+		arrow_proxy operator->() const noexcept { return { **this }; }
+
+	private:
+		const value *_value = nullptr;
+		const value *_base = nullptr;
+		const char *_strings = nullptr;
+	};
 
-	iterator begin() const noexcept { return _value; }
-	iterator end() const noexcept { return _value + _count; }
+	iterator begin() const noexcept { return iterator( _value, _base, _strings ); }
+	iterator end() const noexcept { return iterator( _value + _count, _base, _strings ); }
 	size_t size() const noexcept { return _count; }
 	bool empty() const noexcept { return _count == 0; }
 	value operator[]( size_t index ) const noexcept;
@@ -268,10 +531,17 @@ public:
 private:
 	const value *_value = nullptr;
 	size_t _count = 0;
+	const value *_base = nullptr;
+	const char *_strings = nullptr;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Get 64-bit structural hash of a value (see 'value::hash')
+uint64_t hash( const value &v ) noexcept;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 //---------------------------------------------------------------------------------------------------------------------
 inline value::value( value_type t, uint64_t data )
 {
@@ -320,6 +590,126 @@ inline const char *value::get_c_str( const char *defaultValue ) const noexcept
 	return is_string() ? payload<const char *>() : defaultValue;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string_view value::get_string_view( std::string_view defaultValue ) const noexcept
+{
+	if ( !is_string() )
+		return defaultValue;
+
+	const char *str = payload<const char *>();
+	return std::string_view( str, string_length( str ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint64_t value::hash() const noexcept
+{
+	if ( is_object() || is_array() )
+	{
+		const value *header = header_of( *this );
+		const value *base = base_of( header );
+
+		if ( !( base[1]._data & flag_stale_hashes ) )
+			return header[2]._data;
+
+		return hash_elements( is_object(), header + header_size, header[0].get<size_t>(), base, strings_of( base ) );
+	}
+	else if ( is_string() )
+		return detail::hash_mix( detail::hash_key( get_string_view() ) ^ hash_seed_string );
+	else if ( is_number() )
+	{
+		// Make 0.0 and -0.0 (which are equal) hash the same
+		value v = ( _double == 0.0 ) ? value( 0.0 ) : *this;
+		return detail::hash_mix( v._data );
+	}
+	else if ( is_boolean() )
+		return detail::hash_mix( hash_seed_bool + get_bool() );
+
+	return detail::hash_mix( hash_seed_null );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline uint64_t value::hash_elements( bool isObject, const value *elements, size_t count, const value *base, const char *strings ) noexcept
+{
+	uint64_t result = 0;
+
+	if ( isObject )
+	{
+		// Sum of key-value pair hashes does not depend on their order
+		result = hash_seed_object;
+		for ( size_t i = 0; i < count; i += 2 )
+			result += detail::hash_mix( elements[i].resolve( base, strings ).hash() ^ ( elements[i + 1].resolve( base, strings ).hash() * 31 ) );
+	}
+	else
+	{
+		result = hash_seed_array;
+		for ( size_t i = 0; i < count; ++i )
+			result = detail::hash_mix( result ^ elements[i].resolve( base, strings ).hash() );
+	}
+
+	return detail::hash_mix( result + count );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void value::index_add( value *table, size_t count, std::string_view key, size_t pairIndex ) noexcept
+{
+	const size_t mask = detail::object_index_capacity( count ) - 1;
+
+	size_t slot = detail::hash_key( key ) & mask;
+	while ( index_entry( table, slot ) )
+		slot = ( slot + 1 ) & mask;
+
+	index_entry( table, slot, uint32_t( pairIndex + 1 ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool value::index_build( value *table, const value *pairs, size_t count, const char *strings ) noexcept
+{
+	for ( size_t i = 0, S = index_size( count ); i < S; ++i )
+		table[i]._data = 0;
+
+	const auto keyAt = [pairs, strings]( size_t i ) noexcept
+	{
+		const char *key = strings + pairs[i * 2].payload<size_t>();
+		return std::string_view( key, string_length( key ) );
+	};
+
+	// Same as 'index_add', but repeated keys are found on the way (they share the probe sequence)
+	const size_t mask = detail::object_index_capacity( count ) - 1;
+	bool result = false;
+
+	for ( size_t i = 0; i < count; ++i )
+	{
+		const std::string_view key = keyAt( i );
+		size_t slot = detail::hash_key( key ) & mask;
+
+		for ( uint32_t e; ( e = index_entry( table, slot ) ) != 0; slot = ( slot + 1 ) & mask )
+			result = result || keyAt( e - 1 ) == key;
+
+		index_entry( table, slot, uint32_t( i + 1 ) );
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool value::has_duplicate_keys( const value *pairs, size_t count, const char *strings ) noexcept
+{
+	std::string_view keys[detail::object_index_threshold];
+	count = std::min( count, detail::object_index_threshold );
+
+	for ( size_t i = 0; i < count; ++i )
+	{
+		const char *key = strings + pairs[i * 2].payload<size_t>();
+		keys[i] = std::string_view( key, string_length( key ) );
+
+		for ( size_t j = 0; j < i; ++j )
+			if ( keys[j] == keys[i] )
+				return true;
+	}
+
+	return false;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline bool value::operator==( const value &other ) const noexcept
 {
@@ -332,7 +722,11 @@ inline bool value::operator==( const value &other ) const noexcept
 		else if ( t == value_type::number )
 			return _double == other._double;
 		else if ( t == value_type::string )
-			return std::string_view( payload<const char *>() ) == std::string_view( other.payload<const char *>() );
+			return get_string_view() == other.get_string_view();
+		else if ( payload<const value *>() == other.payload<const value *>() )
+			return true;
+		else if ( has_cached_hash() && other.has_cached_hash() && hash() != other.hash() )
+			return false;
 		else if ( t == value_type::array )
 			return array_view( *this ) == array_view( other );
 		else if ( t == value_type::object )
@@ -353,32 +747,23 @@ inline value value::operator[]( std::string_view key ) const noexcept
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline value value::operator[]( size_t index ) const noexcept
+inline value value::operator[]( const key &k ) const noexcept
 {
-	if ( !is_array() )
+	if ( !is_object() )
 		return value();
 
-	array_view av( *this );
-	return av[index];
+	object_view ov( *this );
+	return ov[k];
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline void value::relink( const class document *prevDoc, const class document &doc ) noexcept
+inline value value::operator[]( size_t index ) const noexcept
 {
-	if ( is_string() )
-	{
-		if ( prevDoc )
-			payload( payload<const char *>() - prevDoc->_strings.data() );
-
-		payload( doc._strings.data() + payload<uint64_t>() );
-	}
-	else if ( is_object() || is_array() )
-	{
-		if ( prevDoc )
-			payload( payload<const value *>() - prevDoc->_values.data() );
+	if ( !is_array() )
+		return value();
 
-		payload( doc._values.data() + payload<uint64_t>() );
-	}
+	array_view av( *this );
+	return av[index];
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -388,48 +773,150 @@ inline void document::assign_copy( const document &copy )
 	_strings = copy._strings;
 	_values = copy._values;
 
-	for ( auto &v : _values )
-		v.relink( &copy, *this );
+	if ( is_object() || is_array() )
+		payload( _values.data() + ( payload<const value *>() - copy._values.data() ) );
 
-	relink( &copy, *this );
+	update_base();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline void document::assign_rvalue( document &&rValue ) noexcept
+inline void document::assign_rvalue( document &&rValue )
 {
-	_data = std::move( rValue._data );
+	if ( this == &rValue )
+		return;
+
+	// Buffers allocated from another memory resource can't be taken over
+	if ( *resource() != *rValue.resource() )
+	{
+		assign_copy( rValue );
+		rValue.clear();
+		return;
+	}
+
+	// Stored values do not need relinking, only the root is rebased (buffers keep their addresses)
+	const value *prevValues = rValue._values.data();
+
+	_data = rValue._data;
 	_strings = std::move( rValue._strings );
 	_values = std::move( rValue._values );
+	rValue._data = type_null;
 
-	for ( auto &v : _values )
-		v.relink( &rValue, *this );
+	if ( is_object() || is_array() )
+		payload( _values.data() + ( payload<const value *>() - prevValues ) );
 
-	for ( auto &v : rValue._values )
-		v.relink( this, rValue );
+	update_base();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool document::has_layout( layout order ) const noexcept
+{
+	// Edited documents have containers moved to the end of the buffer
+	const uint64_t flags = ( _values.size() > 1 ) ? _values[1]._data : 0;
+	if ( flags & value::flag_stale_hashes )
+		return false;
+
+	if ( order == layout::pre_order )
+		return flags & value::flag_pre_order;
+	else if ( order == layout::breadth_first )
+		return flags & value::flag_breadth_first;
+
+	return !( flags & value::flags_layout );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 inline void document::assign_root( value root ) noexcept
 {
-	_data = root._data;
+	_data = root.resolve( _values.data(), _strings.data() )._data;
+	update_base();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void document::update_base() noexcept
+{
+	if ( !_values.empty() )
+		_values[0]._data = reinterpret_cast<uintptr_t>( _strings.data() ) - reinterpret_cast<uintptr_t>( _values.data() );
+}
 
-	for ( auto &v : _values )
-		v.relink( nullptr, *this );
+//---------------------------------------------------------------------------------------------------------------------
+inline key &key::operator=( const key &copy ) noexcept
+{
+	_name = copy._name;
+	_hash = copy._hash;
+	cached_index( copy.cached_index() );
+	return *this;
+}
 
-	relink( nullptr, *this );
+//---------------------------------------------------------------------------------------------------------------------
+inline object_view::object_view( const value &v ) noexcept
+{
+	if ( v.is_object() )
+	{
+		const value *header = value::header_of( v );
+		_pair = header + value::header_size;
+		_count = header[0].get<size_t>() / 2;
+		_base = value::base_of( header );
+		_strings = value::strings_of( _base );
+	}
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 inline object_view::iterator object_view::find( std::string_view key ) const noexcept
 {
-	if ( !key.empty() )
+	const size_t index = index_of( key );
+	return ( index < _count ) ? iterator( _pair + index * 2, _base, _strings ) : end();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline object_view::iterator object_view::find( const key &k ) const noexcept
+{
+	const size_t index = index_of( k );
+	return ( index < _count ) ? iterator( _pair + index * 2, _base, _strings ) : end();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t object_view::index_of( std::string_view key ) const noexcept
+{
+	return index_of( key, value::index_size( _count ) ? detail::hash_key( key ) : 0 );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t object_view::index_of( std::string_view key, uint64_t hash ) const noexcept
+{
+	if ( key.empty() )
+		return _count;
+
+	// Large objects are preceded by a hash index built in 'builder::pop'
+	if ( const size_t indexSize = value::index_size( _count ) )
 	{
-		for ( auto iter = begin(); iter != end(); ++iter )
-			if ( key == ( *iter ).first )
-				return iter;
+		const value *table = _pair - value::header_size - indexSize;
+		const size_t mask = indexSize * 2 - 1;
+
+		for ( size_t i = hash & mask; auto e = value::index_entry( table, i ); i = ( i + 1 ) & mask )
+			if ( key == key_at( _pair + ( e - 1 ) * 2 ) )
+				return e - 1;
+
+		return _count;
 	}
 
-	return end();
+	for ( size_t i = 0; i < _count; ++i )
+		if ( key == key_at( _pair + i * 2 ) )
+			return i;
+
+	return _count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t object_view::index_of( const key &k ) const noexcept
+{
+	const size_t cachedIndex = k.cached_index();
+	if ( cachedIndex < _count && !( _base[1]._data & value::flag_duplicate_keys ) && k._name == key_at( _pair + cachedIndex * 2 ) )
+		return cachedIndex;
+
+	const size_t index = index_of( k._name, k._hash );
+	if ( index < _count )
+		k.cached_index( index );
+
+	return index;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -439,47 +926,98 @@ inline value object_view::operator[]( std::string_view key ) const noexcept
 	return ( iter != end() ) ? ( *iter ).second : value();
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline value object_view::operator[]( const key &k ) const noexcept
+{
+	const auto iter = find( k );
+	return ( iter != end() ) ? ( *iter ).second : value();
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline bool object_view::operator==( const object_view &other ) const noexcept
 {
 	if ( size() != other.size() )
 		return false;
 
-	if ( empty() )
-		return true;
+	const value *pair1 = _pair, *E = _pair + _count * 2;
+	const value *pair2 = other._pair;
 
-	static constexpr size_t stack_pair_count = 256;
-	key_value_pair tempPairs1[stack_pair_count];
-	key_value_pair tempPairs2[stack_pair_count];
-	key_value_pair *pairs1 = _count <= stack_pair_count ? tempPairs1 : new key_value_pair[_count];
-	key_value_pair *pairs2 = _count <= stack_pair_count ? tempPairs2 : new key_value_pair[_count];
-	{ size_t i = 0; for ( const auto kvp : *this ) pairs1[i++] = kvp; }
-	{ size_t i = 0; for ( const auto kvp : other ) pairs2[i++] = kvp; }
-
-	const auto comp = []( const key_value_pair & a, const key_value_pair & b ) noexcept -> bool
-	{ return strcmp( a.first, b.first ) < 0; };
+	// Fast path for objects with keys in the same order
+	for ( ; pair1 != E; pair1 += 2, pair2 += 2 )
+	{
+		if ( key_at( pair1 ) != other.key_at( pair2 ) )
+			break;
 
-	std::sort( pairs1, pairs1 + _count, comp );
-	std::sort( pairs2, pairs2 + _count, comp );
+		if ( pair1[1].resolve( _base, _strings ) != pair2[1].resolve( other._base, other._strings ) )
+			return false;
+	}
 
-	bool result = true;
-	for ( size_t i = 0; i < _count; ++i )
+	// Objects with duplicate keys are equal, when they hold the same multiset of key-value pairs
+	// (their hashes are sums of pair hashes), which lookups by key can't tell
+	if ( !has_unique_keys( pair1 ) || !other.has_unique_keys( pair2 ) )
 	{
-		if ( strcmp( pairs1[i].first, pairs2[i].first ) || pairs1[i].second != pairs2[i].second )
+		for ( const value *pair = pair1; pair != E; pair += 2 )
 		{
-			result = false;
-			break;
+			const auto key = key_at( pair );
+			const auto v = pair[1].resolve( _base, _strings );
+			if ( count_pairs( pair1, key, v ) != other.count_pairs( pair2, key, v ) )
+				return false;
 		}
+
+		return true;
+	}
+
+	// Look up remaining keys in the other object (uses hash index of large objects)
+	for ( ; pair1 != E; pair1 += 2 )
+	{
+		const auto iter = other.find( key_at( pair1 ) );
+		if ( iter == other.end() || ( *iter ).second != pair1[1].resolve( _base, _strings ) )
+			return false;
 	}
 
-	if ( _count > stack_pair_count ) { delete[] pairs1; delete[] pairs2; }
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool object_view::has_unique_keys( const value *first ) const noexcept
+{
+	// Lookup finds one of the pairs sharing a key, so the others are found by their index
+	for ( const value *pair = first, *E = _pair + _count * 2; pair != E; pair += 2 )
+		if ( index_of( key_at( pair ) ) != size_t( pair - _pair ) / 2 )
+			return false;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t object_view::count_pairs( const value *first, std::string_view key, const value &v ) const noexcept
+{
+	size_t result = 0;
+
+	for ( const value *pair = first, *E = _pair + _count * 2; pair != E; pair += 2 )
+		if ( key_at( pair ) == key && pair[1].resolve( _base, _strings ) == v )
+			++result;
+
 	return result;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline array_view::array_view( const value &v ) noexcept
+{
+	if ( v.is_array() )
+	{
+		const value *header = value::header_of( v );
+		_value = header + value::header_size;
+		_count = header[0].get<size_t>();
+		_base = value::base_of( header );
+		_strings = value::strings_of( _base );
+	}
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline value array_view::operator[]( size_t index ) const noexcept
 {
-	return ( index < _count ) ? _value[index] : value();
+	return ( index < _count ) ? _value[index].resolve( _base, _strings ) : value();
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -488,12 +1026,17 @@ inline bool array_view::operator==( const array_view &other ) const noexcept
 	if ( size() != other.size() )
 		return false;
 
-	auto iter = begin();
-	for ( const auto &v : other )
-		if ( *iter++ != v )
+	for ( auto iter1 = begin(), iter2 = other.begin(); iter1 != end(); ++iter1, ++iter2 )
+		if ( *iter1 != *iter2 )
 			return false;
 
 	return true;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline uint64_t hash( const value &v ) noexcept
+{
+	return v.hash();
+}
+
 } // namespace json5
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <string_view>
 #include <tuple>
 
 /*
@@ -109,8 +111,13 @@
 namespace json5 {
 
 /* Forward declarations */
+class array_view;
 class builder;
+class compact_document;
 class document;
+class editor;
+class key;
+class object_view;
 class parser;
 class value;
 
@@ -135,6 +142,11 @@ struct error final
 		wrong_array_size,   // invalid number of array elements
 		invalid_enum,       // invalid enum value or string (conversion failed)
 		could_not_open,     // stream is not open
+		invalid_snapshot,   // invalid binary snapshot (wrong header, version or size)
+		invalid_patch,      // invalid patch operation (unknown or missing member)
+		path_not_found,     // patch path does not reference an existing value
+		test_failed,        // patch "test" operation failed
+		too_large,          // document exceeds limits of the compact representation
 	};
 
 	static constexpr const char *type_string[] =
@@ -142,12 +154,16 @@ struct error final
 		"none", "invalid root", "unexpected end", "syntax error", "invalid literal",
 		"invalid escape sequence", "comma expected", "colon expected", "boolean expected",
 		"number expected", "string expected", "object expected", "array expected",
-		"wrong array size", "invalid enum", "could not open stream",
+		"wrong array size", "invalid enum", "could not open stream", "invalid snapshot",
+		"invalid patch", "path not found", "test failed", "too large",
 	};
 	
 	int type = none;
-	int line = 0;
-	int column = 0;
+	size_t line = 0;
+	size_t column = 0;
+
+	// Index of the failed operation (patch errors only, 'line' and 'column' are 0 then)
+	size_t operation = 0;
 
 	operator int() const noexcept { return type; }
 };
@@ -177,13 +193,59 @@ struct writer_params
 //---------------------------------------------------------------------------------------------------------------------
 enum class value_type { null = 0, boolean, number, array, string, object };
 
+//---------------------------------------------------------------------------------------------------------------------
+// Order of containers in document's value buffer (see 'editor::compact')
+enum class layout
+{
+	post_order,    // children before their parent (as built by parser and builder)
+	pre_order,     // parent before its children, subtrees stay contiguous
+	breadth_first, // containers ordered by depth
+};
+
 } // namespace json5
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 namespace json5::detail {
 
-using string_offset = unsigned;
+/* Forward declarations */
+class snapshot;
+class statistics;
+
+// Offset into document's string buffer (stored in 48-bit value payload)
+using string_offset = uint64_t;
+
+// Every string in document's string buffer is prefixed with its length (and followed by '\0'),
+// so a single string is limited to 4 GB
+using string_length = uint32_t;
+
+// Objects with at least this many key-value pairs get a hash index for 'object_view::find'
+static constexpr size_t object_index_threshold = 16;
+
+// Number of hash index entries for an object with 'count' key-value pairs (power of two, max. 50% load)
+constexpr size_t object_index_capacity( size_t count ) noexcept
+{
+	size_t result = 1;
+	while ( result < count * 2 ) result <<= 1;
+	return result;
+}
+
+// FNV-1a hash of an object key
+constexpr uint64_t hash_key( std::string_view key ) noexcept
+{
+	uint64_t result = 14695981039346656037ull;
+	for ( char ch : key ) { result ^= uint8_t( ch ); result *= 1099511628211ull; }
+	return result;
+}
+
+// Bit mixing function (splitmix64 finalizer) used for structural hashes
+constexpr uint64_t hash_mix( uint64_t x ) noexcept
+{
+	x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27; x *= 0x94d049bb133111ebull;
+	x ^= x >> 31;
+	return x;
+}
 
 template <typename T> struct class_wrapper
 {
@@ -202,11 +264,14 @@ public:
 	virtual int peek() = 0;
 	virtual bool eof() const = 0;
 
+	// Number of chars left to read, if known in advance (used to reserve document buffers)
+	virtual size_t size_hint() const { return 0; }
+
 	error make_error( int type ) const noexcept { return error{ type, _line, _column }; }
 
 protected:
-	int _line = 1;
-	int _column = 1;
+	size_t _line = 1;
+	size_t _column = 1;
 };
 
 } // namespace json5::detail
@@ -0,0 +1,583 @@
+#pragma once
+
+#include "json5.hpp"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+	#if !defined(NOMINMAX)
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace json5 {
+
+// Writes binary snapshot of json5::document into stream
+void to_binary( std::ostream &os, const document &doc );
+
+// Returns binary snapshot of json5::document
+std::string to_binary( const document &doc );
+
+// Write binary snapshot of json5::document into file, returns 'true' on success
+bool to_binary_file( std::string_view fileName, const document &doc );
+
+// Load json5::document from binary snapshot in memory (copies the data, no parsing)
+error from_binary( const void *data, size_t size, document &doc );
+
+// Load json5::document from binary snapshot file
+error from_binary_file( std::string_view fileName, document &doc );
+
+// Writes C++ header, which embeds binary snapshot of json5::document as constant data. The header
+// defines 'name()' function returning 'const json5::snapshot_view &' (no parsing, no heap, the
+// embedded data is trusted, so the view only checks the snapshot header)
+void to_cpp_header( std::ostream &os, const document &doc, std::string_view name );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::snapshot_view
+
+Read-only root value of a binary snapshot stored in external memory, e.g. a memory mapped
+file. Nothing is parsed or copied, all object_view/array_view access goes directly to the
+snapshot data, which must stay valid (and 8-byte aligned) while the view is used.
+
+*/
+class snapshot_view final : public value
+{
+public:
+	// Construct null view
+	snapshot_view() noexcept = default;
+
+	// Tag of snapshots, which come from a trusted source (e.g. embedded by 'to_cpp_header')
+	struct trusted_t { };
+	static constexpr trusted_t trusted = { };
+
+	// Construct view of binary snapshot in memory (null view, if the snapshot is not valid)
+	snapshot_view( const void *data, size_t size ) { assign( data, size ); }
+
+	// Construct view of trusted binary snapshot in memory. Only the snapshot header is checked,
+	// values are not (O(1), does not allocate).
+	snapshot_view( const void *data, size_t size, trusted_t ) noexcept { assign( data, size, trusted ); }
+
+	// Point view at binary snapshot in memory. All values of the snapshot are checked once, so
+	// views never read outside of the snapshot data.
+	error assign( const void *data, size_t size );
+
+	// Point view at trusted binary snapshot in memory (checks only the snapshot header)
+	error assign( const void *data, size_t size, trusted_t ) noexcept;
+
+private:
+	error assign( const void *data, size_t size, bool isTrusted );
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::mapped_file
+
+Read-only memory mapping of a whole file. Pages of the mapping are shared between all
+processes mapping the same file.
+
+*/
+class mapped_file final
+{
+public:
+	mapped_file() noexcept = default;
+	mapped_file( const mapped_file & ) = delete;
+	mapped_file &operator=( const mapped_file & ) = delete;
+	~mapped_file() { close(); }
+
+	// Map file into memory, returns 'true' on success
+	bool open( std::string_view fileName );
+
+	// Unmap file
+	void close() noexcept;
+
+	const void *data() const noexcept { return _data; }
+	size_t size() const noexcept { return _size; }
+
+private:
+#if defined(_WIN32)
+	HANDLE _file = INVALID_HANDLE_VALUE;
+	HANDLE _mapping = nullptr;
+#endif
+
+	const void *_data = nullptr;
+	size_t _size = 0;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+/*
+	Binary snapshot layout:
+
+	- snapshot_header
+	- document values (with base slot set as if strings followed values in memory)
+	- document strings
+*/
+struct snapshot_header
+{
+	static constexpr uint32_t magic_value = 0x4235534Au; // "JS5B"
+	static constexpr uint32_t current_version = 4;
+	static constexpr uint32_t endian_tag = 0x01020304u;
+
+	uint32_t magic = magic_value;
+	uint32_t version = current_version;
+	uint32_t endian = endian_tag;
+	uint32_t value_size = 0;
+	uint64_t value_count = 0;
+	uint64_t string_size = 0;
+	uint64_t root = 0;
+};
+
+static_assert( sizeof( snapshot_header ) % sizeof( uint64_t ) == 0 );
+
+//---------------------------------------------------------------------------------------------------------------------
+class snapshot
+{
+public:
+	static void write( std::ostream &os, const document &doc );
+	static error read( const void *data, size_t size, snapshot_header &header, bool isTrusted = false );
+	static error load( const void *data, size_t size, document &doc );
+	static error view( const void *data, size_t size, value &root, bool isTrusted );
+
+private:
+	static bool validate( const char *bytes, const snapshot_header &header );
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void snapshot::write( std::ostream &os, const document &doc )
+{
+	snapshot_header header;
+	header.value_size = uint32_t( sizeof( value ) );
+	header.value_count = doc._values.size();
+	header.string_size = doc._strings.size();
+	header.root = doc._data;
+
+	if ( doc.is_object() || doc.is_array() )
+	{
+		value root = doc;
+		root.payload( uint64_t( doc.payload<const value *>() - doc._values.data() ) );
+		header.root = root._data;
+	}
+
+	os.write( reinterpret_cast<const char *>( &header ), sizeof( header ) );
+
+	if ( !doc._values.empty() )
+	{
+		// Strings directly follow values in the snapshot
+		value base;
+		base._data = header.value_count * sizeof( value );
+		os.write( reinterpret_cast<const char *>( &base ), sizeof( base ) );
+		os.write( reinterpret_cast<const char *>( doc._values.data() + 1 ), ( doc._values.size() - 1 ) * sizeof( value ) );
+	}
+
+	os.write( doc._strings.data(), doc._strings.size() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot::read( const void *data, size_t size, snapshot_header &header, bool isTrusted )
+{
+	if ( !data || size < sizeof( header ) )
+		return { error::invalid_snapshot };
+
+	memcpy( &header, data, sizeof( header ) );
+
+	if ( header.magic != snapshot_header::magic_value ||
+	     header.version != snapshot_header::current_version ||
+	     header.endian != snapshot_header::endian_tag ||
+	     header.value_size != sizeof( value ) )
+		return { error::invalid_snapshot };
+
+	if ( header.value_count > ( size - sizeof( header ) ) / sizeof( value ) ||
+	     header.string_size != size - sizeof( header ) - header.value_count * sizeof( value ) )
+		return { error::invalid_snapshot };
+
+	if ( !isTrusted && !validate( reinterpret_cast<const char *>( data ) + sizeof( header ), header ) )
+		return { error::invalid_snapshot };
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool snapshot::validate( const char *bytes, const snapshot_header &header )
+{
+	/*
+		Walks all values reachable from the root and checks every index and offset, which views
+		follow: container headers (and references left by moved containers), hash indices of
+		large objects and strings with their length prefix. Containers referencing themselves
+		are rejected, shared containers are checked once (per type they are referenced as).
+	*/
+	static constexpr size_t npos = size_t( -1 );
+	static constexpr uint8_t checked_array = 1, checked_object = 2, active = 4;
+
+	const size_t valueCount = size_t( header.value_count );
+	const size_t stringSize = size_t( header.string_size );
+	const char *strings = bytes + valueCount * sizeof( value );
+
+	// Snapshot data does not need to be aligned, when it is loaded into a document
+	const auto slot = [bytes]( size_t index ) noexcept
+	{
+		value result;
+		memcpy( &result._data, bytes + index * sizeof( value ), sizeof( result._data ) );
+		return result;
+	};
+
+	const auto isString = [strings, stringSize]( uint64_t offset ) noexcept
+	{
+		string_length length = 0;
+		if ( offset < sizeof( length ) || offset >= stringSize )
+			return false;
+
+		memcpy( &length, strings + offset - sizeof( length ), sizeof( length ) );
+		return length < stringSize - offset && strings[offset + length] == 0;
+	};
+
+	// Get index of container header (references left by moved containers are followed)
+	const auto headerOf = [&]( const value &v ) noexcept
+	{
+		size_t index = v.payload<size_t>();
+
+		for ( size_t steps = 0; steps < valueCount; ++steps )
+		{
+			if ( index < value::base_size || index > valueCount || valueCount - index < value::header_size )
+				return npos;
+
+			// Header stores its own index (views find the base slot through it)
+			const value first = slot( index ), indexSlot = slot( index + 1 );
+			if ( !indexSlot.is_number() || indexSlot._double != double( index ) )
+				return npos;
+
+			if ( first.is_number() )
+				return index;
+
+			if ( !first.is_object() && !first.is_array() )
+				return npos;
+
+			index = first.payload<size_t>();
+		}
+
+		return npos;
+	};
+
+	// Hash index entries must point at pairs of the object and leave free entries to end lookups
+	const auto isIndexValid = [&]( size_t headerIndex, size_t pairCount ) noexcept
+	{
+		const size_t indexSize = value::index_size( pairCount );
+		if ( !indexSize )
+			return true;
+
+		if ( headerIndex - value::base_size < indexSize )
+			return false;
+
+		size_t used = 0;
+		for ( size_t i = 0; i < indexSize * 2; ++i )
+		{
+			const value entries = slot( headerIndex - indexSize + i / 2 );
+			const uint32_t e = value::index_entry( &entries, i & 1 );
+			if ( e > pairCount )
+				return false;
+
+			used += e != 0;
+		}
+
+		return used < indexSize * 2;
+	};
+
+	struct container
+	{
+		size_t header_index;
+		size_t next;
+		size_t end;
+		bool is_object;
+	};
+
+	std::vector<uint8_t> state( valueCount );
+	std::vector<container> stack;
+
+	// Checks a value, containers not checked yet are pushed to have their elements checked
+	const auto check = [&]( const value &v )
+	{
+		if ( v.is_string() )
+			return isString( v.payload<uint64_t>() );
+
+		if ( !v.is_object() && !v.is_array() )
+			return true;
+
+		const size_t headerIndex = headerOf( v );
+		if ( headerIndex == npos || ( state[headerIndex] & active ) )
+			return false;
+
+		const uint8_t checked = v.is_object() ? checked_object : checked_array;
+		if ( state[headerIndex] & checked )
+			return true;
+
+		const double count = slot( headerIndex )._double;
+		if ( !( count >= 0.0 ) || count > double( valueCount - headerIndex - value::header_size ) || count != double( size_t( count ) ) )
+			return false;
+
+		const size_t elementCount = size_t( count );
+		if ( v.is_object() && ( elementCount % 2 || !isIndexValid( headerIndex, elementCount / 2 ) ) )
+			return false;
+
+		state[headerIndex] |= checked | active;
+		stack.push_back( { headerIndex, headerIndex + value::header_size, headerIndex + value::header_size + elementCount, v.is_object() } );
+		return true;
+	};
+
+	if ( valueCount && slot( 0 )._data != valueCount * sizeof( value ) )
+		return false;
+
+	value root;
+	root._data = header.root;
+	if ( !check( root ) )
+		return false;
+
+	while ( !stack.empty() )
+	{
+		auto &top = stack.back();
+
+		if ( top.next == top.end )
+		{
+			state[top.header_index] &= ~active;
+			stack.pop_back();
+			continue;
+		}
+
+		// Object keys are strings (pushing a container invalidates 'top')
+		const size_t index = top.next;
+		const bool isObject = top.is_object;
+		top.next += isObject ? 2 : 1;
+
+		if ( isObject && ( !slot( index ).is_string() || !isString( slot( index ).payload<uint64_t>() ) ) )
+			return false;
+
+		if ( !check( slot( isObject ? index + 1 : index ) ) )
+			return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot::load( const void *data, size_t size, document &doc )
+{
+	snapshot_header header;
+	if ( auto err = read( data, size, header ) )
+		return err;
+
+	const char *bytes = reinterpret_cast<const char *>( data ) + sizeof( header );
+
+	doc._values.resize( header.value_count );
+	memcpy( static_cast<void *>( doc._values.data() ), bytes, header.value_count * sizeof( value ) );
+	doc._strings.assign( bytes + header.value_count * sizeof( value ), header.string_size );
+
+	value root;
+	root._data = header.root;
+	doc.assign_root( root );
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot::view( const void *data, size_t size, value &root, bool isTrusted )
+{
+	snapshot_header header;
+	if ( auto err = read( data, size, header, isTrusted ) )
+		return err;
+
+	if ( reinterpret_cast<uintptr_t>( data ) % alignof( value ) )
+		return { error::invalid_snapshot };
+
+	const value *base = reinterpret_cast<const value *>( reinterpret_cast<const char *>( data ) + sizeof( header ) );
+
+	root._data = header.root;
+	root = root.resolve( base, reinterpret_cast<const char *>( base + header.value_count ) );
+	return { error::none };
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot_view::assign( const void *data, size_t size )
+{
+	return assign( data, size, false );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot_view::assign( const void *data, size_t size, trusted_t ) noexcept
+{
+	// Values are not validated, so nothing is allocated
+	return assign( data, size, true );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error snapshot_view::assign( const void *data, size_t size, bool isTrusted )
+{
+	value root;
+	if ( auto err = detail::snapshot::view( data, size, root, isTrusted ) )
+	{
+		*this = snapshot_view();
+		return err;
+	}
+
+	static_cast<value &>( *this ) = root;
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool mapped_file::open( std::string_view fileName )
+{
+	close();
+
+#if defined(_WIN32)
+	_file = CreateFileA( std::string( fileName ).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+	if ( _file == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER fileSize = { };
+	if ( !GetFileSizeEx( _file, &fileSize ) || fileSize.QuadPart == 0 )
+	{
+		close();
+		return false;
+	}
+
+	_mapping = CreateFileMappingA( _file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+	if ( !_mapping )
+	{
+		close();
+		return false;
+	}
+
+	_data = MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 );
+	_size = _data ? size_t( fileSize.QuadPart ) : 0;
+#else
+	int fd = ::open( std::string( fileName ).c_str(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st = { };
+	if ( fstat( fd, &st ) == 0 && st.st_size > 0 )
+	{
+		void *ptr = mmap( nullptr, size_t( st.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+		if ( ptr != MAP_FAILED )
+		{
+			_data = ptr;
+			_size = size_t( st.st_size );
+		}
+	}
+
+	::close( fd );
+#endif
+
+	if ( !_data )
+	{
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void mapped_file::close() noexcept
+{
+#if defined(_WIN32)
+	if ( _data ) UnmapViewOfFile( _data );
+	if ( _mapping ) CloseHandle( _mapping );
+	if ( _file != INVALID_HANDLE_VALUE ) CloseHandle( _file );
+
+	_mapping = nullptr;
+	_file = INVALID_HANDLE_VALUE;
+#else
+	if ( _data ) munmap( const_cast<void *>( _data ), _size );
+#endif
+
+	_data = nullptr;
+	_size = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void to_binary( std::ostream &os, const document &doc )
+{
+	detail::snapshot::write( os, doc );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string to_binary( const document &doc )
+{
+	std::ostringstream os;
+	to_binary( os, doc );
+	return os.str();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool to_binary_file( std::string_view fileName, const document &doc )
+{
+	std::ofstream ofs( std::string( fileName ).c_str(), std::ios::binary );
+	if ( !ofs.is_open() )
+		return false;
+
+	to_binary( ofs, doc );
+	return ofs.good();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void to_cpp_header( std::ostream &os, const document &doc, std::string_view name )
+{
+	static constexpr const char *hexChars = "0123456789abcdef";
+	const std::string data = to_binary( doc );
+
+	os << "// Generated by json5::to_cpp_header, do not edit\n";
+	os << "#pragma once\n\n";
+	os << "#include <json5/json5_binary.hpp>\n\n";
+	os << "alignas( 8 ) inline constexpr unsigned char " << name << "_data[] =\n{";
+
+	for ( size_t i = 0; i < data.size(); ++i )
+	{
+		const auto ch = uint8_t( data[i] );
+		const char buff[5] = { '0', 'x', hexChars[ch >> 4], hexChars[ch & 15], ',' };
+		os << ( ( i % 16 ) ? " " : "\n\t" );
+		os.write( buff, sizeof( buff ) );
+	}
+
+	os << "\n};\n\n";
+	os << "inline const json5::snapshot_view &" << name << "()\n{\n";
+	os << "\tstatic const json5::snapshot_view view( " << name << "_data, sizeof( " << name << "_data ), json5::snapshot_view::trusted );\n";
+	os << "\treturn view;\n}\n";
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error from_binary( const void *data, size_t size, document &doc )
+{
+	return detail::snapshot::load( data, size, doc );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error from_binary_file( std::string_view fileName, document &doc )
+{
+	std::ifstream ifs( std::string( fileName ).c_str(), std::ios::binary | std::ios::ate );
+	if ( !ifs.is_open() )
+		return { error::could_not_open };
+
+	std::string str( size_t( ifs.tellg() ), 0 );
+	ifs.seekg( 0 );
+	ifs.read( str.data(), str.size() );
+	return from_binary( str.data(), str.size(), doc );
+}
+
+} // namespace json5
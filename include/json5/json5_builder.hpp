@@ -7,11 +7,20 @@ namespace json5 {
 class builder
 {
 public:
-	builder( document &doc ) : _doc( doc ) { }
+	builder( document &doc ) : _doc( doc ), _stack( doc.resource() ), _values( doc.resource() ), _counts( doc.resource() ) { }
 
 	const document &doc() const noexcept { return _doc; }
 
+	// Reserve space for 'valueCount' more values and 'stringSize' more string chars in the document
+	void reserve( size_t valueCount, size_t stringSize );
+
+	// Release document buffer capacity, which is not used (e.g. after 'reserve' overestimated)
+	void shrink_to_fit();
+
 	detail::string_offset string_buffer_offset() const noexcept;
+	std::string_view string_buffer_view( detail::string_offset stringOffset ) const noexcept;
+	detail::string_offset string_buffer_begin();
+	void string_buffer_end( detail::string_offset stringOffset );
 	detail::string_offset string_buffer_add( std::string_view str );
 	void string_buffer_add( char ch ) { _doc._strings.push_back( ch ); }
 	void string_buffer_add_utf8( uint32_t ch );
@@ -23,33 +32,115 @@ public:
 	void push_array();
 	value pop();
 
+	// Push array with 'knownCount' elements (a hint). Its elements are written straight to their
+	// final slots in the document, until a nested object or array is pushed or imported into it.
+	void push_array( size_t knownCount );
+
 	builder &operator+=( value v );
+
+	// Append numbers or a string to the current array at once
+	builder &add_numbers( const double *numbers, size_t count );
+	builder &add_string( std::string_view str ) { return ( *this ) += new_string( str ); }
 	value &operator[]( detail::string_offset keyOffset );
 	value &operator[]( std::string_view key ) { return ( *this )[string_buffer_add( key )]; }
 
+	// Copy value (including all nested objects and arrays) from another document. When there
+	// is no container pushed, the copy becomes the document root.
+	value import( const value &v );
+
+	// Copy whole document 'part' (e.g. built on another thread with its own builder). Its value and
+	// string buffers are appended at once and offsets rebased in one pass over the containers.
+	value merge( const document &part );
+
 protected:
 	void reset() noexcept;
+	void reserve_base();
+
+	// Get capacity of document value and string buffers
+	size_t value_capacity() const noexcept { return _doc._values.capacity(); }
+	size_t string_capacity() const noexcept { return _doc._strings.capacity(); }
+
+	// Checks, if more than a quarter of value or string buffer capacity is unused
+	bool has_unused_capacity() const noexcept;
+
+	void stage_elements();
+	bool import_block( const value &v, value &result );
+	bool import_fixup( size_t headerIndex, size_t firstIndex, size_t srcFirst, size_t srcEnd, const char *srcStrings );
+	void fixup_header_indices( size_t headerIndex ) noexcept;
+	value import_copy( const value &v );
+	void merge_fixup( size_t headerIndex, size_t valueDelta, size_t stringDelta ) noexcept;
 
 	document &_doc;
-	std::vector<value> _stack;
-	std::vector<value> _values;
-	std::vector<size_t> _counts;
+	std::pmr::vector<value> _stack;
+	std::pmr::vector<value> _values;
+	std::pmr::vector<size_t> _counts;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::reserve( size_t valueCount, size_t stringSize )
+{
+	_doc._values.reserve( _doc._values.size() + valueCount );
+	_doc._strings.reserve( _doc._strings.size() + stringSize );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool builder::has_unused_capacity() const noexcept
+{
+	const auto isMostlyUnused = []( size_t size, size_t capacity ) { return capacity - size > capacity / 4; };
+	return isMostlyUnused( _doc._values.size(), _doc._values.capacity() ) || isMostlyUnused( _doc._strings.size(), _doc._strings.capacity() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::shrink_to_fit()
+{
+	const value *oldValues = _doc._values.data();
+
+	_doc._values.shrink_to_fit();
+	_doc._strings.shrink_to_fit();
+
+	// Root holds a pointer to its header, strings base moves with the string buffer
+	if ( _doc.is_object() || _doc.is_array() )
+		_doc.payload( _doc._values.data() + ( _doc.payload<const value *>() - oldValues ) );
+
+	_doc.update_base();
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline detail::string_offset builder::string_buffer_offset() const noexcept
 {
 	return detail::string_offset( _doc._strings.size() );
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string_view builder::string_buffer_view( detail::string_offset stringOffset ) const noexcept
+{
+	const char *str = _doc._strings.data() + stringOffset;
+	return std::string_view( str, value::string_length( str ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline detail::string_offset builder::string_buffer_begin()
+{
+	_doc._strings.append( sizeof( detail::string_length ), 0 );
+	return string_buffer_offset();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::string_buffer_end( detail::string_offset stringOffset )
+{
+	auto length = detail::string_length( _doc._strings.size() - stringOffset );
+	memcpy( _doc._strings.data() + stringOffset - sizeof( length ), &length, sizeof( length ) );
+	_doc._strings.push_back( 0 );
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline detail::string_offset builder::string_buffer_add( std::string_view str )
 {
-	auto offset = string_buffer_offset();
+	auto offset = string_buffer_begin();
 	_doc._strings += str;
-	_doc._strings.push_back( 0 );
+	string_buffer_end( offset );
 	return offset;
 }
 
@@ -102,6 +193,8 @@ inline void builder::string_buffer_add_utf8( uint32_t ch )
 //---------------------------------------------------------------------------------------------------------------------
 inline void builder::push_object()
 {
+	stage_elements();
+
 	auto v = value( value_type::object, nullptr );
 	_stack.emplace_back( v );
 	_counts.push_back( 0 );
@@ -110,26 +203,66 @@ inline void builder::push_object()
 //---------------------------------------------------------------------------------------------------------------------
 inline void builder::push_array()
 {
+	stage_elements();
+
 	auto v = value( value_type::array, nullptr );
 	_stack.emplace_back( v );
 	_counts.push_back( 0 );
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::push_array( size_t knownCount )
+{
+	stage_elements();
+	reserve_base();
+
+	// Stack entry of an array written in place holds index of its header
+	const size_t headerIndex = _doc._values.size();
+	_doc._values.reserve( headerIndex + value::header_size + knownCount );
+	_doc._values.resize( headerIndex + value::header_size );
+
+	_stack.emplace_back( value( value_type::array, headerIndex ) );
+	_counts.push_back( 0 );
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline value builder::pop()
 {
 	auto result = _stack.back();
 	auto count = _counts.back();
 
-	result.payload( _doc._values.size() );
+	reserve_base();
+
+	// Hash index of large objects goes in front of the header
+	const size_t indexSize = result.is_object() ? value::index_size( count / 2 ) : 0;
+	const size_t headerIndex = result.payload<size_t>() ? result.payload<size_t>() : _doc._values.size() + indexSize;
+
+	if ( !result.payload<size_t>() )
+	{
+		result.payload( headerIndex );
+
+		_doc._values.resize( headerIndex + value::header_size );
+
+		auto startIndex = _values.size() - count;
+		_doc._values.insert( _doc._values.end(), _values.begin() + startIndex, _values.end() );
+		_values.resize( startIndex );
+	}
+
+	_doc._values[headerIndex] = value( double( count ) );
+	_doc._values[headerIndex + 1] = value( double( headerIndex ) );
 
-	_doc._values.push_back( value( double( count ) ) );
+	value *header = _doc._values.data() + headerIndex;
+	header[2]._data = value::hash_elements( result.is_object(), header + value::header_size, count, _doc._values.data(), _doc._strings.data() );
 
-	auto startIndex = _values.size() - count;
-	for ( size_t i = startIndex, S = _values.size(); i < S; ++i )
-		_doc._values.push_back( _values[i] );
+	if ( result.is_object() )
+	{
+		const bool hasDuplicateKeys = indexSize
+			? value::index_build( header - indexSize, header + value::header_size, count / 2, _doc._strings.data() )
+			: value::has_duplicate_keys( header + value::header_size, count / 2, _doc._strings.data() );
 
-	_values.resize( _values.size() - count );
+		if ( hasDuplicateKeys )
+			_doc._values[1]._data |= value::flag_duplicate_keys;
+	}
 
 	_stack.pop_back();
 	_counts.pop_back();
@@ -146,11 +279,24 @@ inline value builder::pop()
 //---------------------------------------------------------------------------------------------------------------------
 inline builder &builder::operator+=( value v )
 {
-	_values.push_back( v );
+	if ( _stack.back().payload<size_t>() )
+		_doc._values.push_back( v );
+	else
+		_values.push_back( v );
+
 	_counts.back() += 1;
 	return *this;
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline builder &builder::add_numbers( const double *numbers, size_t count )
+{
+	auto &values = _stack.back().payload<size_t>() ? _doc._values : _values;
+	values.insert( values.end(), numbers, numbers + count );
+	_counts.back() += count;
+	return *this;
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline value &builder::operator[]( detail::string_offset keyOffset )
 {
@@ -159,13 +305,305 @@ inline value &builder::operator[]( detail::string_offset keyOffset )
 	return _values.emplace_back();
 }
 
+//---------------------------------------------------------------------------------------------------------------------
+inline value builder::import( const value &v )
+{
+	if ( v.is_string() )
+		return new_string( v.get_string_view() );
+	else if ( !v.is_object() && !v.is_array() )
+		return v;
+
+	// Imported block is appended to the document, after an array written in place
+	stage_elements();
+
+	// Importing from the same document would read from buffers, which are growing during the copy
+	if ( value::base_of( value::header_of( v ) ) == _doc._values.data() )
+	{
+		document tmp;
+		builder( tmp ).import( v );
+		return import( tmp );
+	}
+
+	value result;
+	if ( !import_block( v, result ) )
+		return import_copy( v );
+
+	if ( _stack.empty() )
+	{
+		_doc.assign_root( result );
+		result = _doc;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool builder::import_block( const value &v, value &result )
+{
+	const value *header = value::header_of( v );
+	const value *srcBase = value::base_of( header );
+
+	// Edited documents and documents in breadth-first layout do not keep subtrees in one block
+	const uint64_t flags = srcBase[1]._data;
+	if ( ( flags & value::flag_stale_hashes ) || ( ( flags & value::flag_not_post_order ) && !( flags & value::flag_pre_order ) ) )
+		return false;
+
+	const value *first = header;
+	const value *last = header;
+
+	// In pre-order, the subtree starts with its own block and ends with the block of its last nested container
+	if ( flags & value::flag_pre_order )
+	{
+		first -= v.is_object() ? value::index_size( header[0].get<size_t>() / 2 ) : 0;
+
+		for ( bool isObject = v.is_object(), found = true; found; )
+		{
+			const size_t count = last[0].get<size_t>();
+			const value *elements = last + value::header_size;
+			found = false;
+
+			for ( size_t i = count; i-- > ( isObject ? 1 : 0 ); )
+			{
+				if ( ( !isObject || ( i & 1 ) ) && ( elements[i].is_object() || elements[i].is_array() ) )
+				{
+					last = srcBase + elements[i].payload<size_t>();
+					isObject = elements[i].is_object();
+					found = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// In post-order, the subtree starts with the block of its first nested container
+	for ( bool isObject = v.is_object(), found = !( flags & value::flag_pre_order ); found; )
+	{
+		const size_t count = first[0].get<size_t>();
+		const value *elements = first + value::header_size;
+		found = false;
+
+		for ( size_t i = isObject ? 1 : 0; i < count; i += isObject ? 2 : 1 )
+		{
+			if ( elements[i].is_object() || elements[i].is_array() )
+			{
+				first = srcBase + elements[i].payload<size_t>();
+				isObject = elements[i].is_object();
+				found = true;
+				break;
+			}
+		}
+
+		if ( !found && isObject )
+			first -= value::index_size( count / 2 );
+	}
+
+	const size_t srcFirst = size_t( first - srcBase );
+	const size_t srcHeader = size_t( header - srcBase );
+	const size_t srcEnd = size_t( last - srcBase ) + value::header_size + last[0].get<size_t>();
+
+	// Containers referenced more than once might be stored outside of the subtree block
+	if ( srcFirst > srcHeader || srcEnd <= srcHeader )
+		return false;
+
+	// Copy the whole block at once, then fix header indices and string offsets
+	reserve_base();
+
+	const size_t firstIndex = _doc._values.size();
+	const size_t stringsSize = _doc._strings.size();
+	_doc._values.insert( _doc._values.end(), srcBase + srcFirst, srcBase + srcEnd );
+
+	const size_t headerIndex = srcHeader - srcFirst + firstIndex;
+	if ( !import_fixup( headerIndex, firstIndex, srcFirst, srcEnd, value::strings_of( srcBase ) ) )
+	{
+		_doc._values.resize( firstIndex );
+		_doc._strings.resize( stringsSize );
+		return false;
+	}
+
+	fixup_header_indices( headerIndex );
+	_doc._values[1]._data |= flags & value::flag_duplicate_keys;
+
+	// Pre-order block keeps its layout, so the document is in pre-order only when it holds just
+	// the block (e.g. subtree imported into an empty document), otherwise it is mixed
+	if ( flags & value::flag_pre_order )
+	{
+		const bool onlyBlock = firstIndex == value::base_size && _stack.empty();
+		_doc._values[1]._data |= value::flag_not_post_order | ( onlyBlock ? value::flag_pre_order : 0 );
+	}
+
+	result = value( v.type(), headerIndex );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool builder::import_fixup( size_t headerIndex, size_t firstIndex, size_t srcFirst, size_t srcEnd, const char *srcStrings )
+{
+	// Containers referenced more than once (builder allows that) are fixed up only once, header
+	// index of visited containers is null until 'fixup_header_indices'
+	value *header = _doc._values.data() + headerIndex;
+	if ( header[1].is_null() )
+		return true;
+
+	header[1] = value();
+
+	for ( value *e = header + value::header_size, *E = e + header[0].get<size_t>(); e != E; ++e )
+	{
+		if ( e->is_string() )
+		{
+			// Copy length prefix, chars and '\0' at once
+			const char *str = srcStrings + e->payload<size_t>();
+			const size_t offset = _doc._strings.size() + sizeof( detail::string_length );
+
+			_doc._strings.append( str - sizeof( detail::string_length ), sizeof( detail::string_length ) + value::string_length( str ) + 1 );
+			e->payload( uint64_t( offset ) );
+		}
+		else if ( e->is_object() || e->is_array() )
+		{
+			const size_t srcIndex = e->payload<size_t>();
+			if ( srcIndex < srcFirst || srcIndex >= srcEnd )
+				return false;
+
+			e->payload( uint64_t( srcIndex - srcFirst + firstIndex ) );
+			if ( !import_fixup( e->payload<size_t>(), firstIndex, srcFirst, srcEnd, srcStrings ) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::fixup_header_indices( size_t headerIndex ) noexcept
+{
+	value *header = _doc._values.data() + headerIndex;
+	if ( !header[1].is_null() )
+		return;
+
+	header[1] = value( double( headerIndex ) );
+
+	for ( value *e = header + value::header_size, *E = e + header[0].get<size_t>(); e != E; ++e )
+		if ( e->is_object() || e->is_array() )
+			fixup_header_indices( e->payload<size_t>() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value builder::merge( const document &part )
+{
+	// Edited documents and documents with other layouts are merged subtree by subtree
+	if ( &part == &_doc || ( !part.is_object() && !part.is_array() ) || part._values[1]._data != 0 )
+		return import( part );
+
+	stage_elements();
+	reserve_base();
+
+	const size_t valueDelta = _doc._values.size() - value::base_size;
+	const size_t stringDelta = _doc._strings.size();
+	const size_t headerIndex = size_t( value::header_of( part ) - part._values.data() ) + valueDelta;
+
+	_doc._values.insert( _doc._values.end(), part._values.begin() + value::base_size, part._values.end() );
+	_doc._strings += part._strings;
+	merge_fixup( headerIndex, valueDelta, stringDelta );
+	fixup_header_indices( headerIndex );
+
+	value result( part.type(), headerIndex );
+	if ( _stack.empty() )
+	{
+		_doc.assign_root( result );
+		result = _doc;
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::merge_fixup( size_t headerIndex, size_t valueDelta, size_t stringDelta ) noexcept
+{
+	// Slots are told apart by walking the containers (header hashes and hash indices are raw bits),
+	// shared containers are rebased once like in 'import_fixup'
+	value *header = _doc._values.data() + headerIndex;
+	if ( header[1].is_null() )
+		return;
+
+	header[1] = value();
+
+	for ( value *e = header + value::header_size, *E = e + header[0].get<size_t>(); e != E; ++e )
+	{
+		if ( e->is_string() )
+			e->payload( e->payload<uint64_t>() + stringDelta );
+		else if ( e->is_object() || e->is_array() )
+		{
+			e->payload( e->payload<uint64_t>() + valueDelta );
+			merge_fixup( e->payload<size_t>(), valueDelta, stringDelta );
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value builder::import_copy( const value &v )
+{
+	if ( v.is_string() )
+		return new_string( v.get_string_view() );
+	else if ( v.is_array() )
+	{
+		push_array();
+
+		for ( auto item : array_view( v ) )
+			*this += import_copy( item );
+
+		return pop();
+	}
+	else if ( v.is_object() )
+	{
+		push_object();
+
+		for ( auto kvp : object_view( v ) )
+		{
+			const auto keyOffset = string_buffer_add( std::string_view( kvp.first, value::string_length( kvp.first ) ) );
+			const value item = import_copy( kvp.second );
+			( *this )[keyOffset] = item;
+		}
+
+		return pop();
+	}
+
+	return v;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::reserve_base()
+{
+	// Reserve document base slot and flags (document with appended post-order block is in post-order
+	// only if it was before, otherwise its containers are in no particular order)
+	if ( _doc._values.empty() )
+	{
+		_doc._values.resize( value::base_size );
+		_doc._values[1]._data = 0;
+	}
+	else
+		_doc._values[1]._data &= ~( value::flag_pre_order | value::flag_breadth_first );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void builder::stage_elements()
+{
+	// Array written in place is the last block of the document. Its elements are moved to the
+	// staging buffer, before anything else is appended to the document (keeps the post-order).
+	if ( _stack.empty() || !_stack.back().payload<size_t>() )
+		return;
+
+	const size_t headerIndex = _stack.back().payload<size_t>();
+	_values.insert( _values.end(), _doc._values.begin() + headerIndex + value::header_size, _doc._values.end() );
+	_doc._values.resize( headerIndex );
+	_stack.back().payload( uint64_t( 0 ) );
+}
+
 //---------------------------------------------------------------------------------------------------------------------
 inline void builder::reset() noexcept
 {
 	_doc._data = value::type_null;
 	_doc._values.clear();
 	_doc._strings.clear();
-	_doc._strings.push_back( 0 );
+	string_buffer_add( std::string_view() );
 }
 
 } // namespace json5
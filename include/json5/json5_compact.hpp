@@ -0,0 +1,480 @@
+#pragma once
+
+#include "json5_builder.hpp"
+
+#include <cmath>
+#include <unordered_map>
+
+namespace json5 {
+
+/*
+
+json5::compact_document
+
+Compact form of a document for keeping many (mostly small) documents in memory, e.g. in a cache.
+Every value takes a 4-byte slot instead of 8 bytes, containers store just their element count
+instead of the 3-slot header and large objects drop their hash index:
+
+- null, booleans and integers in range [-2^28, 2^28) are stored inline
+- other numbers are stored inline when exactly representable as float (and the lowest 3 mantissa
+  bits are zero), otherwise they are spilled to a side table
+- strings and containers are referenced by offsets (at most 512 MB of strings and 512M slots)
+- objects with the same key sequence (e.g. records in an array) share one "shape" with the keys
+  and store only their values, unpacked documents share the key strings too
+
+Single values are read in place through json5::compact_view (see 'root'). 'unpack' rebuilds
+a regular document (recomputing hashes and indices) for object_view/array_view, reflection and
+output, which is worth it when most of the document is going to be read.
+
+*/
+class compact_view;
+
+//---------------------------------------------------------------------------------------------------------------------
+class compact_document final
+{
+public:
+	// Construct empty compact document
+	compact_document() = default;
+
+	// Construct empty compact document, which allocates its buffers from memory 'resource'
+	explicit compact_document( std::pmr::memory_resource *resource ) noexcept
+		: _slots( resource ), _numbers( resource ), _strings( resource ) { }
+
+	// Construct compact form of 'doc' (empty, if the document exceeds compact limits)
+	explicit compact_document( const document &doc ) { assign( doc ); }
+
+	// Pack document into compact form
+	error assign( const document &doc );
+
+	// Rebuild regular document from compact form
+	void unpack( document &doc ) const;
+
+	// Get view of the root value for reading without 'unpack'
+	compact_view root() const noexcept;
+
+	// Get number of bytes reserved by compact document buffers
+	size_t reserved_bytes() const noexcept { return _slots.capacity() * sizeof( uint32_t ) + _numbers.capacity() * sizeof( double ) + _strings.capacity(); }
+
+	// Reset compact document to null value
+	void clear() noexcept { _root = slot_null; _slots.clear(); _numbers.clear(); _strings.clear(); }
+
+private:
+	// Slot tag (lowest 3 bits), the rest of the slot is the payload
+	enum : uint32_t { tag_literal, tag_integer, tag_number, tag_float, tag_string, tag_array, tag_object };
+
+	static constexpr uint32_t tag_mask = 7;
+	static constexpr uint32_t max_payload = 1u << 29;
+	static constexpr uint32_t slot_null = ( 0 << 3 ) | tag_literal;
+	static constexpr uint32_t slot_false = ( 1 << 3 ) | tag_literal;
+	static constexpr uint32_t slot_true = ( 2 << 3 ) | tag_literal;
+
+	struct pack_state
+	{
+		std::vector<uint32_t> stack;
+		std::unordered_map<std::string, uint32_t> shapes;
+		std::string keys;
+	};
+
+	bool pack_value( const value &v, uint32_t &slot, pack_state &state );
+	bool pack_shape( const value &object, uint32_t &shapeIndex, pack_state &state );
+	bool pack_string( std::string_view str, uint32_t &slot );
+	value unpack_value( builder &b, uint32_t slot ) const;
+
+	// Read number or string stored in a slot (slot must be tagged accordingly)
+	double slot_number( uint32_t slot ) const noexcept;
+	std::string_view slot_string( uint32_t slot ) const noexcept;
+
+	uint32_t _root = slot_null;
+	std::pmr::vector<uint32_t> _slots;
+	std::pmr::vector<double> _numbers;
+	std::pmr::string _strings;
+
+	friend compact_view;
+};
+
+/*
+
+json5::compact_view
+
+Read-only view of a value packed in json5::compact_document. Objects keep no hash index in compact
+form, so looking up a key compares keys of the object one by one (first match is returned, the
+same as object_view does). Views are valid until the compact document is modified or destroyed.
+
+*/
+class compact_view final
+{
+public:
+	// Construct view of null value
+	compact_view() noexcept = default;
+
+	// Return value type
+	value_type type() const noexcept;
+
+	// Checks the type of viewed value
+	bool is_null() const noexcept { return type() == value_type::null; }
+	bool is_boolean() const noexcept { return type() == value_type::boolean; }
+	bool is_number() const noexcept { return type() == value_type::number; }
+	bool is_string() const noexcept { return type() == value_type::string; }
+	bool is_object() const noexcept { return type() == value_type::object; }
+	bool is_array() const noexcept { return type() == value_type::array; }
+
+	// Get stored bool. Returns 'defaultValue', if this value is not a boolean.
+	bool get_bool( bool defaultValue = false ) const noexcept;
+
+	// Get stored number as type 'T'. Returns 'defaultValue', if this value is not a number.
+	template <typename T>
+	T get( T defaultValue = 0 ) const noexcept
+	{
+		return is_number() ? T( _doc->slot_number( _slot ) ) : defaultValue;
+	}
+
+	// Get stored string. Returns 'defaultValue', if this value is not a string.
+	std::string_view get_string_view( std::string_view defaultValue = std::string_view() ) const noexcept;
+
+	// Get number of array elements or object properties (0 for other values)
+	size_t size() const noexcept;
+
+	// Get array element or value of object property at 'index'. Returns null view, if this value
+	// is not an array or object, or 'index' is out of bounds.
+	compact_view operator[]( size_t index ) const noexcept;
+
+	// Get value of object property 'key'. Returns null view, if this value is not an object or
+	// 'key' is not found.
+	compact_view operator[]( std::string_view key ) const noexcept;
+
+	// Get key of object property at 'index'. Returns empty string, if this value is not an object
+	// or 'index' is out of bounds.
+	std::string_view key( size_t index ) const noexcept;
+
+private:
+	compact_view( const compact_document *doc, uint32_t slot ) noexcept : _doc( doc ), _slot( slot ) { }
+
+	// Get slots of an array (count, elements) or object (shape index, values) and of object's shape (count, keys)
+	const uint32_t *header() const noexcept { return _doc->_slots.data() + ( _slot >> 3 ); }
+	const uint32_t *shape() const noexcept { return _doc->_slots.data() + header()[0]; }
+
+	const compact_document *_doc = nullptr;
+	uint32_t _slot = compact_document::slot_null;
+
+	friend compact_document;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error compact_document::assign( const document &doc )
+{
+	clear();
+
+	pack_state state;
+	uint32_t root = slot_null;
+
+	if ( !pack_value( doc, root, state ) )
+	{
+		clear();
+		return { error::too_large };
+	}
+
+	// Compact documents are meant to be kept around, so give back what the buffers over-allocated
+	_slots.shrink_to_fit();
+	_numbers.shrink_to_fit();
+	_strings.shrink_to_fit();
+
+	_root = root;
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void compact_document::unpack( document &doc ) const
+{
+	doc.clear();
+
+	// String offsets are kept, so the whole string buffer is copied at once
+	doc._strings = _strings;
+	doc._values.reserve( value::base_size + _slots.size() + _slots.size() / 2 );
+
+	builder b( doc );
+	const value root = unpack_value( b, _root );
+
+	if ( !root.is_object() && !root.is_array() )
+		doc.assign_root( root );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline compact_view compact_document::root() const noexcept
+{
+	return compact_view( this, _root );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool compact_document::pack_value( const value &v, uint32_t &slot, pack_state &state )
+{
+	if ( v.is_null() )
+		slot = slot_null;
+	else if ( v.is_boolean() )
+		slot = v.get_bool() ? slot_true : slot_false;
+	else if ( v.is_number() )
+	{
+		const double number = v.get<double>();
+		const float single = float( number );
+
+		uint32_t bits = 0;
+		memcpy( &bits, &single, sizeof( bits ) );
+
+		if ( number >= -double( max_payload / 2 ) && number < double( max_payload / 2 ) && number == double( int32_t( number ) ) && ( number != 0.0 || !std::signbit( number ) ) )
+			slot = ( uint32_t( int32_t( number ) ) << 3 ) | tag_integer;
+		else if ( double( single ) == number && ( bits & tag_mask ) == 0 )
+			slot = bits | tag_float;
+		else
+		{
+			if ( _numbers.size() >= max_payload )
+				return false;
+
+			slot = ( uint32_t( _numbers.size() ) << 3 ) | tag_number;
+			_numbers.push_back( number );
+		}
+	}
+	else if ( v.is_string() )
+		return pack_string( v.get_string_view(), slot );
+	else
+	{
+		// Containers are stored in post-order, elements are collected on the stack first. Objects
+		// store the index of their shape in place of the element count.
+		auto &stack = state.stack;
+		const size_t start = stack.size();
+		uint32_t shapeIndex = 0;
+
+		if ( v.is_object() )
+		{
+			for ( auto kvp : object_view( v ) )
+			{
+				uint32_t item = 0;
+				if ( !pack_value( kvp.second, item, state ) )
+					return false;
+
+				stack.push_back( item );
+			}
+
+			if ( !pack_shape( v, shapeIndex, state ) )
+				return false;
+		}
+		else
+		{
+			for ( auto element : array_view( v ) )
+			{
+				uint32_t item = 0;
+				if ( !pack_value( element, item, state ) )
+					return false;
+
+				stack.push_back( item );
+			}
+		}
+
+		const size_t count = stack.size() - start;
+		if ( _slots.size() + 1 + count > max_payload )
+			return false;
+
+		slot = ( uint32_t( _slots.size() ) << 3 ) | ( v.is_object() ? tag_object : tag_array );
+		_slots.push_back( v.is_object() ? shapeIndex : uint32_t( count ) );
+		_slots.insert( _slots.end(), stack.begin() + start, stack.end() );
+		stack.resize( start );
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool compact_document::pack_shape( const value &object, uint32_t &shapeIndex, pack_state &state )
+{
+	// Shapes are looked up by all keys of the object, each prefixed with its length
+	state.keys.clear();
+
+	for ( auto kvp : object_view( object ) )
+	{
+		const auto length = detail::string_length( value::string_length( kvp.first ) );
+		state.keys.append( reinterpret_cast<const char *>( &length ), sizeof( length ) );
+		state.keys.append( kvp.first, length );
+	}
+
+	if ( auto iter = state.shapes.find( state.keys ); iter != state.shapes.end() )
+	{
+		shapeIndex = iter->second;
+		return true;
+	}
+
+	// Shape is the number of keys followed by the keys
+	const size_t start = state.stack.size();
+
+	for ( auto kvp : object_view( object ) )
+	{
+		uint32_t key = 0;
+		if ( !pack_string( std::string_view( kvp.first, value::string_length( kvp.first ) ), key ) )
+			return false;
+
+		state.stack.push_back( key );
+	}
+
+	const size_t count = state.stack.size() - start;
+	if ( _slots.size() + 1 + count > max_payload )
+		return false;
+
+	shapeIndex = uint32_t( _slots.size() );
+	_slots.push_back( uint32_t( count ) );
+	_slots.insert( _slots.end(), state.stack.begin() + start, state.stack.end() );
+	state.stack.resize( start );
+
+	state.shapes.emplace( state.keys, shapeIndex );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool compact_document::pack_string( std::string_view str, uint32_t &slot )
+{
+	const size_t offset = _strings.size() + sizeof( detail::string_length );
+	if ( offset + str.size() + 1 > max_payload )
+		return false;
+
+	const auto length = detail::string_length( str.size() );
+	_strings.append( reinterpret_cast<const char *>( &length ), sizeof( length ) );
+	_strings += str;
+	_strings.push_back( 0 );
+
+	slot = ( uint32_t( offset ) << 3 ) | tag_string;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value compact_document::unpack_value( builder &b, uint32_t slot ) const
+{
+	switch ( slot & tag_mask )
+	{
+		case tag_literal: return ( slot == slot_null ) ? value() : value( slot == slot_true );
+		case tag_integer: case tag_number: case tag_float: return value( slot_number( slot ) );
+		case tag_string: return b.new_string( detail::string_offset( slot >> 3 ) );
+
+		case tag_array:
+		{
+			const uint32_t *header = _slots.data() + ( slot >> 3 );
+			b.push_array();
+
+			for ( uint32_t i = 1; i <= header[0]; ++i )
+				b += unpack_value( b, header[i] );
+
+			return b.pop();
+		}
+
+		case tag_object:
+		{
+			const uint32_t *header = _slots.data() + ( slot >> 3 );
+			const uint32_t *shape = _slots.data() + header[0];
+			b.push_object();
+
+			for ( uint32_t i = 1; i <= shape[0]; ++i )
+			{
+				const value item = unpack_value( b, header[i] );
+				b[detail::string_offset( shape[i] >> 3 )] = item;
+			}
+
+			return b.pop();
+		}
+	}
+
+	return value();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline double compact_document::slot_number( uint32_t slot ) const noexcept
+{
+	if ( ( slot & tag_mask ) == tag_integer )
+		return double( int32_t( slot ) >> 3 );
+	else if ( ( slot & tag_mask ) == tag_number )
+		return _numbers[slot >> 3];
+
+	const uint32_t bits = slot & ~tag_mask;
+	float single = 0.0f;
+	memcpy( &single, &bits, sizeof( single ) );
+	return double( single );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string_view compact_document::slot_string( uint32_t slot ) const noexcept
+{
+	const char *str = _strings.data() + ( slot >> 3 );
+	detail::string_length length = 0;
+	memcpy( &length, str - sizeof( length ), sizeof( length ) );
+	return std::string_view( str, length );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value_type compact_view::type() const noexcept
+{
+	switch ( _slot & compact_document::tag_mask )
+	{
+		case compact_document::tag_literal: return ( _slot == compact_document::slot_null ) ? value_type::null : value_type::boolean;
+		case compact_document::tag_string: return value_type::string;
+		case compact_document::tag_array: return value_type::array;
+		case compact_document::tag_object: return value_type::object;
+	}
+
+	return value_type::number;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool compact_view::get_bool( bool defaultValue ) const noexcept
+{
+	return is_boolean() ? ( _slot == compact_document::slot_true ) : defaultValue;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string_view compact_view::get_string_view( std::string_view defaultValue ) const noexcept
+{
+	return is_string() ? _doc->slot_string( _slot ) : defaultValue;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t compact_view::size() const noexcept
+{
+	if ( is_array() )
+		return header()[0];
+	else if ( is_object() )
+		return shape()[0];
+
+	return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline compact_view compact_view::operator[]( size_t index ) const noexcept
+{
+	// Values of object properties are stored the same way as array elements
+	if ( index >= size() )
+		return compact_view();
+
+	return compact_view( _doc, header()[1 + index] );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline compact_view compact_view::operator[]( std::string_view key ) const noexcept
+{
+	if ( !is_object() )
+		return compact_view();
+
+	const uint32_t *keys = shape();
+	for ( uint32_t i = 1; i <= keys[0]; ++i )
+		if ( _doc->slot_string( keys[i] ) == key )
+			return compact_view( _doc, header()[i] );
+
+	return compact_view();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline std::string_view compact_view::key( size_t index ) const noexcept
+{
+	if ( !is_object() || index >= shape()[0] )
+		return std::string_view();
+
+	return _doc->slot_string( shape()[1 + index] );
+}
+
+} // namespace json5
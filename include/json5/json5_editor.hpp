@@ -0,0 +1,542 @@
+#pragma once
+
+#include "json5_builder.hpp"
+
+#include <algorithm>
+
+namespace json5 {
+
+/*
+
+json5::editor
+
+Edits a document in place, without rebuilding it. Replacing a value writes a single slot, a
+container growing past its capacity is moved to the end of the document with doubled capacity
+(leaving a reference to its new place behind), so 'set' and 'push_back' are amortized O(1).
+Inserting or erasing in the middle only shifts elements of the edited container. Moved containers
+keep their capacity in the document, so it is not lost between editor instances (e.g. patches).
+
+Moved containers and erased values keep occupying the document buffers, until 'compact' rebuilds
+the document into a dense layout. Until then structural hashes of the whole document are stale:
+'hash' is recomputed recursively (O(size) instead of O(1)) and equality can no longer reject
+different containers by their hashes, as it does for parsed or built documents.
+
+Every edit invalidates values and views obtained from the document before (except the document
+itself), the same way as growing a std::vector invalidates its iterators. Strings, objects and
+arrays passed as 'v' are copied into the edited document.
+
+*/
+class editor final
+{
+public:
+	editor( document &doc ) : _doc( doc ) { }
+
+	const document &doc() const noexcept { return _doc; }
+
+	// Get empty object or array to be passed as 'v' to the edit functions
+	static const document &empty_object();
+	static const document &empty_array();
+
+	// Create new string in the edited document (valid until the next edit)
+	value new_string( std::string_view str );
+
+	// Set property 'key' of 'object' (replaces existing value or appends new property).
+	// Returns the stored value, or null, if 'object' is not an object of the edited document.
+	value set( const value &object, std::string_view key, const value &v );
+
+	// Erase property 'key' of 'object'. Returns false, if the key is not found.
+	bool erase( const value &object, std::string_view key );
+
+	// Replace element at 'index' of 'array'. Returns the stored value, or null, if 'index' is out of bounds.
+	value set( const value &array, size_t index, const value &v );
+
+	// Insert element before 'index' of 'array' (at most array size). Returns the stored value.
+	value insert( const value &array, size_t index, const value &v );
+
+	// Append element to 'array'. Returns the stored value.
+	value push_back( const value &array, const value &v );
+
+	// Erase element at 'index' of 'array'. Returns false, if 'index' is out of bounds.
+	bool erase( const value &array, size_t index );
+
+	// Replace the whole document with a copy of 'v'. Returns false, if 'v' is not an object or array.
+	bool assign( const value &v );
+
+	// Rebuild the document into a dense layout. Post-order is what parsing produces, pre-order
+	// places containers right before their children (the order in which output, filter and
+	// reflection read them) and breadth-first places containers by depth.
+	void compact( layout order = layout::post_order );
+
+private:
+	bool owns( const void *ptr, const void *data, size_t size ) const noexcept;
+	size_t follow( size_t headerIndex ) const noexcept;
+	size_t capacity( size_t headerIndex, bool isMoved ) const noexcept;
+
+	value begin_edit() const noexcept;
+	void end_edit( value root ) noexcept;
+
+	value container( const value &v, bool *isMoved = nullptr ) const noexcept;
+	value store( const value &v );
+	value resolve( value stored ) const noexcept;
+	value reserve( value container, bool isMoved, size_t count );
+	void update_index( value container ) noexcept;
+	void relayout( layout order );
+
+	document &_doc;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline const document &editor::empty_object()
+{
+	static const document result = []() { document doc; builder b( doc ); b.push_object(); b.pop(); return doc; }();
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline const document &editor::empty_array()
+{
+	static const document result = []() { document doc; builder b( doc ); b.push_array(); b.pop(); return doc; }();
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::new_string( std::string_view str )
+{
+	auto result = builder( _doc ).new_string( str );
+	_doc.update_base();
+	return resolve( result );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::set( const value &object, std::string_view key, const value &v )
+{
+	bool isMoved = false;
+	auto obj = container( object, &isMoved );
+	if ( !obj.is_object() )
+		return value();
+
+	const value root = begin_edit();
+	const value stored = store( v );
+
+	const size_t count = _doc._values[obj.payload<size_t>()].get<size_t>() / 2;
+	size_t index = object_view( resolve( obj ) ).index_of( key );
+
+	if ( index == count )
+	{
+		const auto keyOffset = builder( _doc ).string_buffer_add( key );
+		obj = reserve( obj, isMoved, count * 2 + 2 );
+
+		value *header = _doc._values.data() + obj.payload<size_t>();
+		header[value::header_size + count * 2] = value( value_type::string, keyOffset );
+		header[0] = value( double( count * 2 + 2 ) );
+
+		if ( value::index_size( count + 1 ) != value::index_size( count ) )
+			update_index( obj );
+		else if ( const size_t indexSize = value::index_size( count + 1 ) )
+			value::index_add( header - indexSize, count + 1, key, count );
+	}
+
+	_doc._values[obj.payload<size_t>() + value::header_size + index * 2 + 1] = stored;
+	end_edit( root );
+	return resolve( stored );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool editor::erase( const value &object, std::string_view key )
+{
+	const auto obj = container( object );
+	if ( !obj.is_object() )
+		return false;
+
+	value *header = _doc._values.data() + obj.payload<size_t>();
+	const size_t count = header[0].get<size_t>() / 2;
+	const size_t index = object_view( resolve( obj ) ).index_of( key );
+
+	if ( index == count )
+		return false;
+
+	const value root = begin_edit();
+	value *pair = header + value::header_size + index * 2;
+	std::copy( pair + 2, header + value::header_size + count * 2, pair );
+	header[0] = value( double( count * 2 - 2 ) );
+
+	update_index( obj );
+	end_edit( root );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::set( const value &array, size_t index, const value &v )
+{
+	const auto arr = container( array );
+	if ( !arr.is_array() || index >= _doc._values[arr.payload<size_t>()].get<size_t>() )
+		return value();
+
+	const value root = begin_edit();
+	const value stored = store( v );
+
+	_doc._values[arr.payload<size_t>() + value::header_size + index] = stored;
+	end_edit( root );
+	return resolve( stored );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::insert( const value &array, size_t index, const value &v )
+{
+	bool isMoved = false;
+	auto arr = container( array, &isMoved );
+	if ( !arr.is_array() )
+		return value();
+
+	const size_t count = _doc._values[arr.payload<size_t>()].get<size_t>();
+	if ( index > count )
+		return value();
+
+	const value root = begin_edit();
+	const value stored = store( v );
+	arr = reserve( arr, isMoved, count + 1 );
+
+	value *header = _doc._values.data() + arr.payload<size_t>();
+	value *elements = header + value::header_size;
+	std::copy_backward( elements + index, elements + count, elements + count + 1 );
+	elements[index] = stored;
+	header[0] = value( double( count + 1 ) );
+
+	end_edit( root );
+	return resolve( stored );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::push_back( const value &array, const value &v )
+{
+	const auto arr = container( array );
+	if ( !arr.is_array() )
+		return value();
+
+	return insert( array, _doc._values[arr.payload<size_t>()].get<size_t>(), v );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool editor::erase( const value &array, size_t index )
+{
+	const auto arr = container( array );
+	if ( !arr.is_array() )
+		return false;
+
+	value *header = _doc._values.data() + arr.payload<size_t>();
+	const size_t count = header[0].get<size_t>();
+	if ( index >= count )
+		return false;
+
+	const value root = begin_edit();
+	value *elements = header + value::header_size;
+	std::copy( elements + index + 1, elements + count, elements + index );
+	header[0] = value( double( count - 1 ) );
+
+	end_edit( root );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool editor::assign( const value &v )
+{
+	if ( !v.is_object() && !v.is_array() )
+		return false;
+
+	document result( _doc.resource() );
+	builder( result ).import( v );
+
+	_doc = std::move( result );
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void editor::compact( layout order )
+{
+	// Import copies edited documents value by value (in post-order), other documents in blocks
+	// keeping their layout, so those are relaid out instead
+	const bool isStale = _doc._values.size() > 1 && ( _doc._values[1]._data & value::flag_stale_hashes );
+	if ( isStale || ( order == layout::post_order && _doc.has_layout( layout::post_order ) ) )
+		assign( _doc );
+
+	if ( !_doc.has_layout( order ) && ( _doc.is_object() || _doc.is_array() ) )
+		relayout( order );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool editor::owns( const void *ptr, const void *data, size_t size ) const noexcept
+{
+	const auto p = reinterpret_cast<uintptr_t>( ptr ), d = reinterpret_cast<uintptr_t>( data );
+	return p >= d && p < d + size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t editor::follow( size_t headerIndex ) const noexcept
+{
+	while ( !_doc._values[headerIndex].is_number() )
+		headerIndex = _doc._values[headerIndex].payload<size_t>();
+
+	return headerIndex;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t editor::capacity( size_t headerIndex, bool isMoved ) const noexcept
+{
+	// Containers moved by the editor (reached through the reference left at their previous place)
+	// store their capacity in place of the structural hash, which is stale in edited documents
+	const value *header = _doc._values.data() + headerIndex;
+	const size_t count = header[0].get<size_t>();
+	if ( !isMoved || !header[2].is_number() )
+		return count;
+
+	const double cap = header[2].get<double>();
+	const size_t maxCapacity = _doc._values.size() - headerIndex - value::header_size;
+	return ( cap > double( count ) && cap <= double( maxCapacity ) ) ? size_t( cap ) : count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::begin_edit() const noexcept
+{
+	// Root keeps referencing its first place, so a moved root is recognized as other moved containers
+	value root = _doc;
+	if ( root.is_object() || root.is_array() )
+		root.payload( uint64_t( _doc.payload<const value *>() - _doc._values.data() ) );
+
+	return root;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void editor::end_edit( value root ) noexcept
+{
+	// Buffers might have been reallocated
+	_doc.assign_root( root );
+	_doc._values[1]._data |= value::flag_stale_hashes;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::container( const value &v, bool *isMoved ) const noexcept
+{
+	if ( !v.is_object() && !v.is_array() )
+		return value();
+
+	const auto *header = v.payload<const value *>();
+	if ( !owns( header, _doc._values.data(), _doc._values.size() * sizeof( value ) ) )
+		return value();
+
+	const size_t headerIndex = size_t( header - _doc._values.data() );
+	value result = v;
+	result.payload( follow( headerIndex ) );
+
+	if ( isMoved )
+		*isMoved = result.payload<size_t>() != headerIndex;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::store( const value &v )
+{
+	if ( v.is_string() )
+	{
+		// Strings are immutable, so the document can reference its own strings more than once
+		const char *str = v.payload<const char *>();
+		if ( owns( str, _doc._strings.data(), _doc._strings.size() ) )
+			return value( value_type::string, uint64_t( str - _doc._strings.data() ) );
+
+		const value result = builder( _doc ).new_string( v.get_string_view() );
+		_doc.update_base();
+		return result;
+	}
+	else if ( v.is_object() || v.is_array() )
+	{
+		// Containers of this document are copied out first, while its flags still tell import
+		// to follow moved containers instead of copying blocks as they are
+		document copy( _doc.resource() );
+		const bool isOwn = owns( v.payload<const value *>(), _doc._values.data(), _doc._values.size() * sizeof( value ) );
+		if ( isOwn )
+			builder( copy ).import( v );
+
+		// Copied containers are new, so their hashes can be computed from cached ones
+		const uint64_t flags = _doc._values[1]._data;
+		_doc._values[1]._data = 0;
+
+		builder b( _doc );
+		b.push_array(); // Keeps the copy from becoming the document root
+		const value result = b.import( isOwn ? static_cast<const value &>( copy ) : v );
+
+		_doc._values[1]._data = flags | ( _doc._values[1]._data & value::flag_duplicate_keys );
+		_doc.update_base();
+		return result;
+	}
+
+	return v;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::resolve( value stored ) const noexcept
+{
+	return stored.resolve( _doc._values.data(), _doc._strings.data() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value editor::reserve( value container, bool isMoved, size_t count )
+{
+	const size_t headerIndex = container.payload<size_t>();
+	const size_t prevCapacity = capacity( headerIndex, isMoved );
+	if ( count <= prevCapacity )
+		return container;
+
+	const size_t newCapacity = std::max( { count, prevCapacity * 2, size_t( 4 ) } );
+	const size_t indexSize = container.is_object() ? value::index_size( newCapacity / 2 ) : 0;
+
+	// Move the container to the end, leaving room for its hash index in front of it
+	auto &values = _doc._values;
+	const size_t newIndex = values.size() + indexSize;
+	const size_t prevCount = values[headerIndex].get<size_t>();
+
+	values.resize( newIndex + value::header_size + newCapacity );
+	std::copy( values.begin() + headerIndex, values.begin() + headerIndex + value::header_size + prevCount, values.begin() + newIndex );
+	values[newIndex + 1] = value( double( newIndex ) );
+	values[newIndex + 2] = value( double( newCapacity ) );
+	values[headerIndex] = value( container.type(), newIndex );
+
+	container.payload( newIndex );
+
+	if ( container.is_object() )
+		update_index( container );
+
+	return container;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void editor::update_index( value container ) noexcept
+{
+	value *header = _doc._values.data() + container.payload<size_t>();
+	const size_t count = header[0].get<size_t>() / 2;
+
+	if ( const size_t indexSize = value::index_size( count ) )
+		value::index_build( header - indexSize, header + value::header_size, count, _doc._strings.data() );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void editor::relayout( layout order )
+{
+	const auto &values = _doc._values;
+
+	// Collect containers (header indices) in the new order. Containers referenced more than once
+	// (builder allows that) are collected once, when they are reached first.
+	const value rootContainer = container( _doc );
+	std::vector<value> containers, children;
+	std::vector<bool> visited( values.size() );
+
+	const auto getChildren = [&values]( value c, std::vector<value> &out )
+	{
+		const value *header = values.data() + c.payload<size_t>();
+		const size_t count = header[0].get<size_t>(), step = c.is_object() ? 2 : 1;
+		out.clear();
+
+		for ( size_t i = step - 1; i < count; i += step )
+			if ( header[value::header_size + i].is_object() || header[value::header_size + i].is_array() )
+				out.push_back( header[value::header_size + i] );
+	};
+
+	if ( order == layout::breadth_first )
+	{
+		containers.push_back( rootContainer );
+		visited[rootContainer.payload<size_t>()] = true;
+
+		for ( size_t i = 0; i < containers.size(); ++i )
+		{
+			getChildren( containers[i], children );
+
+			for ( const auto &c : children )
+			{
+				if ( !visited[c.payload<size_t>()] )
+				{
+					visited[c.payload<size_t>()] = true;
+					containers.push_back( c );
+				}
+			}
+		}
+	}
+	else
+	{
+		// Depth-first, pre-order takes containers when they are reached and post-order after their
+		// children (containers are pushed again as 'expanded'). Children are pushed in reverse, so
+		// the first one is visited first.
+		std::vector<std::pair<value, bool>> stack( 1, { rootContainer, false } );
+
+		while ( !stack.empty() )
+		{
+			const auto [c, expanded] = stack.back();
+			stack.pop_back();
+
+			if ( expanded )
+			{
+				containers.push_back( c );
+				continue;
+			}
+			else if ( visited[c.payload<size_t>()] )
+				continue;
+
+			visited[c.payload<size_t>()] = true;
+
+			if ( order == layout::pre_order )
+				containers.push_back( c );
+			else
+				stack.emplace_back( c, true );
+
+			getChildren( c, children );
+
+			for ( size_t i = children.size(); i-- > 0; )
+				if ( !visited[children[i].payload<size_t>()] )
+					stack.emplace_back( children[i], false );
+		}
+	}
+
+	// Assign new header indices (hash index of large objects stays in front of the header)
+	std::vector<size_t> remap( values.size() );
+	size_t size = value::base_size;
+
+	for ( const auto &c : containers )
+	{
+		const size_t count = values[c.payload<size_t>()].get<size_t>();
+		size += c.is_object() ? value::index_size( count / 2 ) : 0;
+		remap[c.payload<size_t>()] = size;
+		size += value::header_size + count;
+	}
+
+	// Copy blocks into their new places, rebasing references to nested containers
+	std::pmr::vector<value> result( _doc.resource() );
+	result.reserve( size );
+	result.insert( result.end(), values.begin(), values.begin() + value::base_size );
+
+	for ( const auto &c : containers )
+	{
+		const size_t headerIndex = c.payload<size_t>();
+		const size_t count = values[headerIndex].get<size_t>();
+		const size_t indexSize = c.is_object() ? value::index_size( count / 2 ) : 0;
+
+		result.insert( result.end(), values.begin() + headerIndex - indexSize, values.begin() + headerIndex + value::header_size + count );
+		result[remap[headerIndex] + 1] = value( double( remap[headerIndex] ) );
+
+		for ( value *e = result.data() + remap[headerIndex] + value::header_size, *E = e + count; e != E; ++e )
+			if ( e->is_object() || e->is_array() )
+				e->payload( uint64_t( remap[e->payload<size_t>()] ) );
+	}
+
+	result[1]._data &= ~value::flags_layout;
+
+	if ( order == layout::pre_order )
+		result[1]._data |= value::flag_not_post_order | value::flag_pre_order;
+	else if ( order == layout::breadth_first )
+		result[1]._data |= value::flag_not_post_order | value::flag_breadth_first;
+
+	const value root( rootContainer.type(), remap[rootContainer.payload<size_t>()] );
+	_doc._values = std::move( result );
+	_doc.assign_root( root );
+}
+
+} // namespace json5
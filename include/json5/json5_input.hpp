@@ -55,6 +55,8 @@ private:
 	error parse_literal( token_type &result );
 
 	detail::char_source &_chars;
+
+	friend class transcoder;
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -126,11 +128,77 @@ public:
 
 	bool eof() const override { return _size == 0; }
 
+	size_t size_hint() const override { return _size; }
+
 protected:
 	const char* _cursor = nullptr;
 	size_t _size = 0;
 };
 
+//---------------------------------------------------------------------------------------------------------------------
+class file_source : public char_source
+{
+public:
+	static constexpr size_t block_size = 64 * 1024;
+
+	file_source( std::istream &is, size_t fileSize ) : _is( is ), _fileSize( fileSize ), _buffer( block_size, 0 ) { fill(); }
+
+	int next() override
+	{
+		if ( _cursor == _end && !fill() )
+			return -1;
+
+		int ch = uint8_t( *_cursor++ );
+
+		if ( ch == '\n' )
+		{
+			_column = 0;
+			++_line;
+		}
+
+		++_column;
+		return ch;
+	}
+
+	int peek() override
+	{
+		if ( _cursor == _end && !fill() )
+			return -1;
+
+		return uint8_t( *_cursor );
+	}
+
+	bool eof() const override { return _cursor == _end && ( !_is || _consumed >= _fileSize ); }
+
+	size_t size_hint() const override
+	{
+		const size_t consumed = _consumed - size_t( _end - _cursor );
+		return ( _fileSize > consumed ) ? _fileSize - consumed : 0;
+	}
+
+protected:
+	// Reads next block of the file, returns false at the end of file
+	bool fill()
+	{
+		if ( !_is )
+			return false;
+
+		_is.read( _buffer.data(), std::streamsize( _buffer.size() ) );
+		const size_t numRead = size_t( _is.gcount() );
+		_cursor = _buffer.data();
+		_end = _cursor + numRead;
+		_consumed += numRead;
+		return numRead > 0;
+	}
+
+	std::istream &_is;
+	size_t _fileSize = 0;
+	size_t _consumed = 0;
+	std::string _buffer;
+	const char *_cursor = nullptr;
+	const char *_end = nullptr;
+};
+
 } // namespace detail
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -140,9 +208,24 @@ inline error parser::parse()
 {
 	reset();
 
+	// Reserve document buffers up front, so huge inputs are not copied over and over while the
+	// buffers grow (string data rarely exceeds the input size, one value per 8 chars is typical).
+	// The estimate is generous, buffers of documents parsed into before (e.g. from
+	// json5::document_pool) are kept as they are, when they cover at least half of it.
+	const size_t sizeHint = _chars.size_hint();
+	const size_t valueHint = sizeHint / 8;
+	const bool isFresh = value_capacity() == 0;
+	reserve( ( value_capacity() < valueHint / 2 ) ? valueHint : 0, ( string_capacity() < sizeHint / 2 ) ? sizeHint : 0 );
+
 	if ( auto err = parse_value( _doc ) )
 		return err;
 
+	// Fresh documents give back capacity, which stays mostly unused. Documents parsed into before
+	// keep their buffers for reuse, and with resources other than the heap (e.g. arenas) a copy
+	// would only leave a dead block behind.
+	if ( sizeHint && isFresh && *_doc.resource() == *std::pmr::new_delete_resource() && has_unused_capacity() )
+		shrink_to_fit();
+
 	if ( !_doc.is_array() && !_doc.is_object() )
 		return make_error( error::invalid_root );
 
@@ -433,7 +516,7 @@ inline error parser::parse_string( detail::string_offset &result )
 	bool singleQuoted = peek() == '\'';
 	next(); // Consume '\'' or '"'
 
-	result = string_buffer_offset();
+	result = string_buffer_begin();
 
 	while ( !eof() )
 	{
@@ -497,14 +580,14 @@ inline error parser::parse_string( detail::string_offset &result )
 	if ( eof() )
 		return make_error( error::unexpected_end );
 
-	string_buffer_add( 0 );
+	string_buffer_end( result );
 	return { error::none };
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 inline error parser::parse_identifier( detail::string_offset &result )
 {
-	result = string_buffer_offset();
+	result = string_buffer_begin();
 
 	int firstCh = peek();
 	bool isString = ( firstCh == '\'' ) || ( firstCh == '"' );
@@ -528,7 +611,7 @@ inline error parser::parse_identifier( detail::string_offset &result )
 	if ( isString && firstCh != next() ) // Consume '\'' or '"'
 		return make_error( error::syntax_error );
 
-	string_buffer_add( 0 );
+	string_buffer_end( result );
 	return { error::none };
 }
 
@@ -589,12 +672,17 @@ inline error from_string( std::string_view str, document &doc )
 //---------------------------------------------------------------------------------------------------------------------
 inline error from_file( std::string_view fileName, document &doc )
 {
-	std::ifstream ifs( std::string( fileName ).c_str() );
+	std::ifstream ifs( std::string( fileName ).c_str(), std::ios::ate );
 	if ( !ifs.is_open() )
 		return { error::could_not_open };
 
-	auto str = std::string( std::istreambuf_iterator<char>( ifs ), std::istreambuf_iterator<char>() );
-	return from_string( std::string_view( str ), doc );
+	// Files are parsed as they are read in blocks, without holding the whole input in memory
+	const auto fileSize = ifs.tellg();
+	ifs.seekg( 0 );
+
+	detail::file_source src( ifs, ( fileSize > 0 ) ? size_t( fileSize ) : 0 );
+	parser r( doc, src );
+	return r.parse();
 }
 
 } // namespace json5
@@ -2,16 +2,17 @@
 
 #include "json5.hpp"
 
-#include <iomanip>
+#include <charconv>
+#include <cmath>
 #include <fstream>
-#include <sstream>
+#include <limits>
 
 namespace json5 {
 
 // Writes json5::document into stream
 void to_stream( std::ostream &os, const document &doc, const writer_params &wp = writer_params() );
 
-// Converts json5::document to string
+// Converts json5::document to string (written straight into 'str', reusing its capacity)
 void to_string( std::string &str, const document &doc, const writer_params &wp = writer_params() );
 
 // Returns json5::document converted to string
@@ -22,93 +23,164 @@ bool to_file( const std::string &fileName, const document &doc, const writer_par
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace detail {
+
+/*
+	Append-only output buffer. Writers append chars to a std::string directly, without virtual
+	calls or stream formatting. Sinks, which pass the output on (e.g. to a stream), override
+	'flush' and get called between values, once the buffer holds at least 'flush_size' chars.
+*/
+class char_sink
+{
+public:
+	explicit char_sink( std::string &buffer, size_t flushSize = std::string::npos ) noexcept
+		: _buffer( buffer ), _flushSize( flushSize ) { }
+
+	char_sink( const char_sink & ) = delete;
+	char_sink &operator=( const char_sink & ) = delete;
+
+	virtual ~char_sink() = default;
+
+	void put( char ch ) { _buffer.push_back( ch ); }
+	void write( std::string_view str ) { _buffer.append( str ); }
+	void write_number( double number );
+
+	void commit() { if ( _buffer.size() >= _flushSize ) flush(); }
+	virtual void flush() { }
+
+protected:
+	std::string &_buffer;
+	size_t _flushSize;
+};
+
 //---------------------------------------------------------------------------------------------------------------------
-inline void to_stream( std::ostream &os, const char *str, char quotes, bool escapeUnicode )
+class stl_ostream final : public char_sink
 {
+public:
+	static constexpr size_t flush_size = 64 * 1024;
+
+	stl_ostream( std::ostream &os ) : char_sink( _chunk, flush_size ), _os( os ) { }
+	~stl_ostream() override { flush(); }
+
+	void flush() override
+	{
+		_os.write( _buffer.data(), std::streamsize( _buffer.size() ) );
+		_buffer.clear();
+	}
+
+private:
+	std::string _chunk;
+	std::ostream &_os;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void char_sink::write_number( double number )
+{
+	// Same output as std::ostream: integers in full, other numbers (and integers out of int64
+	// range) with 6 significant digits
+	char buff[32];
+	std::to_chars_result result;
+
+	if ( double _; std::modf( number, &_ ) == 0.0 && number >= -9223372036854775808.0 && number < 9223372036854775808.0 )
+		result = std::to_chars( buff, buff + sizeof( buff ), int64_t( number ) );
+	else
+		result = std::to_chars( buff, buff + sizeof( buff ), number, std::chars_format::general, 6 );
+
+	_buffer.append( buff, result.ptr );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void write_string( char_sink &out, std::string_view str, char quotes, bool escapeUnicode )
+{
+	static constexpr const char *hexChars = "0123456789abcdef";
+
 	if ( quotes )
-		os << quotes;
+		out.put( quotes );
 
-	while ( *str )
+	// Runs of characters, that don't need escaping, are written in bulk
+	size_t runStart = 0, i = 0;
+	while ( i < str.size() )
 	{
-		bool advance = true;
-
-		if ( str[0] == '\n' )
-			os << "\\n";
-		else if ( str[0] == '\r' )
-			os << "\\r";
-		else if ( str[0] == '\t' )
-			os << "\\t";
-		else if ( str[0] == '"' && quotes == '"' )
-			os << "\\\"";
-		else if ( str[0] == '\'' && quotes == '\'' )
-			os << "\\'";
-		else if ( str[0] == '\\' )
-			os << "\\\\";
-		else if ( uint8_t( str[0] ) >= 128 && escapeUnicode )
+		const char *escape = nullptr;
+		const auto ch = uint8_t( str[i] );
+
+		if ( ch == '\n' )
+			escape = "\\n";
+		else if ( ch == '\r' )
+			escape = "\\r";
+		else if ( ch == '\t' )
+			escape = "\\t";
+		else if ( ch == '"' && quotes == '"' )
+			escape = "\\\"";
+		else if ( ch == '\'' && quotes == '\'' )
+			escape = "\\'";
+		else if ( ch == '\\' )
+			escape = "\\\\";
+		else if ( ch >= 32 && ( ch < 128 || !escapeUnicode ) )
 		{
-			uint32_t ch = 0;
+			++i;
+			continue;
+		}
 
-			if ( ( *str & 0b1110'0000u ) == 0b1100'0000u )
-			{
-				ch |= ( ( *str++ ) & 0b0001'1111u ) << 6;
-				ch |= ( ( *str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *str & 0b1111'0000u ) == 0b1110'0000u )
-			{
-				ch |= ( ( *str++ ) & 0b0000'1111u ) << 12;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *str & 0b1111'1000u ) == 0b1111'0000u )
-			{
-				ch |= ( ( *str++ ) & 0b0000'0111u ) << 18;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *str & 0b1111'1100u ) == 0b1111'1000u )
-			{
-				ch |= ( ( *str++ ) & 0b0000'0011u ) << 24;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 18;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *str++ ) & 0b0011'1111u );
-			}
-			else if ( ( *str & 0b1111'1110u ) == 0b1111'1100u )
+		out.write( str.substr( runStart, i - runStart ) );
+
+		if ( escape )
+		{
+			out.write( escape );
+			++i;
+		}
+		else
+		{
+			// Decode UTF-8 sequence, number of leading 1-bits gives its length
+			size_t length = 0;
+			while ( length < 8 && ( ch & ( 0x80u >> length ) ) )
+				++length;
+
+			uint32_t code = ch & ( 0x7fu >> length );
+
+			if ( length == 0 )
+				length = 1;
+			else if ( length == 1 || length > 6 || i + length > str.size() )
 			{
-				ch |= ( ( *str++ ) & 0b0000'0001u ) << 30;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 24;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 18;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 12;
-				ch |= ( ( *str++ ) & 0b0011'1111u ) << 6;
-				ch |= ( ( *str++ ) & 0b0011'1111u );
+				code = std::numeric_limits<uint32_t>::max(); // Invalid or truncated sequence
+				length = 1;
 			}
 
-			if ( ch <= std::numeric_limits<uint16_t>::max() )
+			for ( size_t j = 1; j < length; ++j )
+				code = ( code << 6 ) | ( uint8_t( str[i + j] ) & 0b0011'1111u );
+
+			if ( code <= std::numeric_limits<uint16_t>::max() )
 			{
-				os << "\\u" << std::hex << std::setfill( '0' ) << std::setw( 4 ) << ch;
+				const char buff[6] = { '\\', 'u', hexChars[( code >> 12 ) & 15], hexChars[( code >> 8 ) & 15], hexChars[( code >> 4 ) & 15], hexChars[code & 15] };
+				out.write( std::string_view( buff, sizeof( buff ) ) );
 			}
 			else
-				os << "?"; // JSON can't encode Unicode chars > 65535 (emojis)
+				out.put( '?' ); // JSON can't encode Unicode chars > 65535 (emojis)
 
-			advance = false;
+			i += length;
 		}
-		else
-			os << *str;
 
-		if ( advance )
-			++str;
+		runStart = i;
 	}
 
+	out.write( str.substr( runStart ) );
+
 	if ( quotes )
-		os << quotes;
+		out.put( quotes );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline void to_stream( std::ostream &os, const value &v, const writer_params &wp, int depth )
+inline void write_indent( char_sink &out, std::string_view indentation, int depth )
+{
+	for ( int i = 0; i < depth; ++i )
+		out.write( indentation );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void write_value( char_sink &out, const value &v, const writer_params &wp, int depth )
 {
-	const char *kvSeparator = ": ";
-	const char *eol = wp.eol;
+	std::string_view kvSeparator = ": ";
+	std::string_view eol = wp.eol;
 
 	if ( wp.compact )
 	{
@@ -118,82 +190,106 @@ inline void to_stream( std::ostream &os, const value &v, const writer_params &wp
 	}
 
 	if ( v.is_null() )
-		os << "null";
+		out.write( "null" );
 	else if ( v.is_boolean() )
-		os << ( v.get_bool() ? "true" : "false" );
+		out.write( v.get_bool() ? "true" : "false" );
 	else if ( v.is_number() )
-	{
-		if ( double _, d = v.get<double>(); modf( d, &_ ) == 0.0 )
-			os << v.get<int64_t>();
-		else
-			os << d;
-	}
+		out.write_number( v.get<double>() );
 	else if ( v.is_string() )
-	{
-		to_stream( os, v.get_c_str(), '"', wp.escape_unicode );
-	}
+		write_string( out, v.get_string_view(), '"', wp.escape_unicode );
 	else if ( v.is_array() )
 	{
 		if ( auto av = json5::array_view( v ); !av.empty() )
 		{
-			os << "[" << eol;
+			out.put( '[' );
+			out.write( eol );
+
 			for ( size_t i = 0, S = av.size(); i < S; ++i )
 			{
-				for ( int i = 0; i <= depth; ++i ) os << wp.indentation;
-				to_stream( os, av[i], wp, depth + 1 );
-				if ( i < S - 1 ) os << ",";
-				os << eol;
+				write_indent( out, wp.indentation, depth + 1 );
+				write_value( out, av[i], wp, depth + 1 );
+				if ( i < S - 1 ) out.put( ',' );
+				out.write( eol );
+				out.commit();
 			}
 
-			for ( int i = 0; i < depth; ++i ) os << wp.indentation;
-			os << "]";
+			write_indent( out, wp.indentation, depth );
+			out.put( ']' );
 		}
 		else
-			os << "[]";
+			out.write( "[]" );
 	}
 	else if ( v.is_object() )
 	{
 		if ( auto ov = json5::object_view( v ); !ov.empty() )
 		{
-			os << "{" << eol;
+			out.put( '{' );
+			out.write( eol );
+
 			size_t count = ov.size();
 			for ( auto kvp : ov )
 			{
-				for ( int i = 0; i <= depth; ++i ) os << wp.indentation;
+				const std::string_view key( kvp.first );
+				write_indent( out, wp.indentation, depth + 1 );
 
 				if ( wp.json_compatible )
-					os << "\"" << kvp.first << "\"" << kvSeparator;
+				{
+					out.put( '"' );
+					out.write( key );
+					out.put( '"' );
+				}
 				else
-					os << kvp.first << kvSeparator;
+					out.write( key );
 
-				to_stream( os, kvp.second, wp, depth + 1 );
-				if ( --count ) os << ",";
-				os << eol;
+				out.write( kvSeparator );
+				write_value( out, kvp.second, wp, depth + 1 );
+				if ( --count ) out.put( ',' );
+				out.write( eol );
+				out.commit();
 			}
 
-			for ( int i = 0; i < depth; ++i ) os << wp.indentation;
-			os << "}";
+			write_indent( out, wp.indentation, depth );
+			out.put( '}' );
 		}
 		else
-			os << "{}";
+			out.write( "{}" );
 	}
 
 	if ( !depth )
-		os << eol;
+		out.write( eol );
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void to_stream( std::ostream &os, const char *str, char quotes, bool escapeUnicode )
+{
+	detail::stl_ostream out( os );
+	detail::write_string( out, str, quotes, escapeUnicode );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void to_stream( std::ostream &os, const value &v, const writer_params &wp, int depth )
+{
+	detail::stl_ostream out( os );
+	detail::write_value( out, v, wp, depth );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 inline void to_stream( std::ostream &os, const document &doc, const writer_params &wp )
 {
-	to_stream( os, doc, wp, 0 );
+	detail::stl_ostream out( os );
+	detail::write_value( out, doc, wp, 0 );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 inline void to_string( std::string &str, const document &doc, const writer_params &wp )
 {
-	std::ostringstream os;
-	to_stream( os, doc, wp );
-	str = os.str();
+	str.clear();
+	detail::char_sink out( str );
+	detail::write_value( out, doc, wp, 0 );
 }
 
 //---------------------------------------------------------------------------------------------------------------------
@@ -216,17 +312,21 @@ inline bool to_file( const std::string &fileName, const document &doc, const wri
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline void to_stream( std::ostream &os, const error &err )
+inline std::string to_string( const error &err )
 {
-	os << err.type_string[err.type] << " at " << err.line << ":" << err.column;
+	// Parsing errors have position in the input (lines start at 1), patch errors the failed operation
+	if ( err.line )
+		return std::string( err.type_string[err.type] ) + " at " + std::to_string( err.line ) + ":" + std::to_string( err.column );
+	else if ( err.type >= error::invalid_patch && err.type <= error::test_failed )
+		return std::string( err.type_string[err.type] ) + " in operation " + std::to_string( err.operation );
+
+	return err.type_string[err.type];
 }
 
 //---------------------------------------------------------------------------------------------------------------------
-inline std::string to_string( const error &err )
+inline void to_stream( std::ostream &os, const error &err )
 {
-	std::ostringstream os;
-	to_stream( os, err );
-	return os.str();
+	os << to_string( err );
 }
 
 } // namespace json5
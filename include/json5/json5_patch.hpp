@@ -0,0 +1,442 @@
+#pragma once
+
+#include "json5_editor.hpp"
+#include "json5_pointer.hpp"
+
+namespace json5 {
+
+// Apply RFC 7386 merge patch to json5::document. Only the values mentioned in the patch are
+// touched, the rest of the document is neither copied nor rebuilt.
+error apply_merge_patch( document &doc, const value &patch );
+
+// Apply RFC 7386 merge patch through an existing editor
+error apply_merge_patch( editor &e, const value &patch );
+
+// Apply RFC 6902 JSON patch (array of operations) to json5::document. Operations are applied in
+// place one by one, so when an operation fails, the operations before it stay applied (index of
+// the failed operation is returned in 'error::operation').
+error apply_patch( document &doc, const value &patch );
+
+// Apply RFC 6902 JSON patch through an existing editor
+error apply_patch( editor &e, const value &patch );
+
+// Compute RFC 6902 JSON patch, which turns 'a' into 'b' (when applied with 'apply_patch')
+document diff( const value &a, const value &b );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+/*
+	Applies patches through json5::editor. Every edit invalidates values of the edited document,
+	so targets are looked up again from the root before each edit. Patches must not be a part
+	of the edited document.
+*/
+class patcher final
+{
+public:
+	patcher( editor &e ) : _editor( e ), _doc( e.doc() ) { }
+
+	error merge( const value &patch );
+	error apply( const value &patch );
+
+private:
+	using path = pointer;
+
+	void merge_object( std::vector<std::string_view> &keys, const value &patch );
+	error apply_operation( const value &operation );
+
+	static bool array_index( const path &p, size_t i, size_t size, size_t &out ) noexcept;
+	static bool starts_with( const path &p, const path &prefix ) noexcept;
+
+	error add( const path &p, const value &v );
+	error remove( const path &p );
+	error replace( const path &p, const value &v );
+
+	editor &_editor;
+	const document &_doc;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::merge( const value &patch )
+{
+	if ( !patch.is_object() )
+		return { _editor.assign( patch ) ? error::none : error::invalid_root };
+
+	if ( !_doc.is_object() )
+		_editor.assign( editor::empty_object() );
+
+	std::vector<std::string_view> keys;
+	merge_object( keys, patch );
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void patcher::merge_object( std::vector<std::string_view> &keys, const value &patch )
+{
+	for ( auto kvp : object_view( patch ) )
+	{
+		value target = _doc;
+		for ( auto key : keys )
+			target = target[key];
+
+		if ( kvp.second.is_null() )
+			_editor.erase( target, kvp.first );
+		else if ( kvp.second.is_object() )
+		{
+			if ( !target[kvp.first].is_object() )
+				_editor.set( target, kvp.first, editor::empty_object() );
+
+			keys.push_back( kvp.first );
+			merge_object( keys, kvp.second );
+			keys.pop_back();
+		}
+		else
+			_editor.set( target, kvp.first, kvp.second );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::apply( const value &patch )
+{
+	if ( !patch.is_array() )
+		return { error::array_expected };
+
+	size_t index = 0;
+	for ( auto operation : array_view( patch ) )
+	{
+		if ( auto err = apply_operation( operation ) )
+		{
+			err.operation = index;
+			return err;
+		}
+
+		++index;
+	}
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::apply_operation( const value &operation )
+{
+	const object_view ov( operation );
+	const auto valueIter = ov.find( "value" );
+	const std::string_view op = ov["op"].get_string_view();
+
+	path target, from;
+	if ( !ov["path"].is_string() || target.assign( ov["path"].get_string_view() ) )
+		return { error::invalid_patch };
+
+	if ( op == "add" || op == "replace" || op == "test" )
+	{
+		if ( valueIter == ov.end() )
+			return { error::invalid_patch };
+
+		const value v = ( *valueIter ).second;
+
+		if ( op == "add" )
+			return add( target, v );
+		else if ( op == "replace" )
+			return replace( target, v );
+
+		value current;
+		if ( !target.find( _doc, current ) )
+			return { error::path_not_found };
+
+		return { ( current == v ) ? error::none : error::test_failed };
+	}
+	else if ( op == "remove" )
+		return remove( target );
+	else if ( op == "move" || op == "copy" )
+	{
+		if ( !ov["from"].is_string() || from.assign( ov["from"].get_string_view() ) )
+			return { error::invalid_patch };
+
+		value v;
+		if ( !from.find( _doc, v ) )
+			return { error::path_not_found };
+
+		if ( op == "copy" )
+			return add( target, v );
+
+		// A value cannot be moved into its own child
+		if ( from.size() < target.size() && starts_with( target, from ) )
+			return { error::invalid_patch };
+
+		if ( from.size() == target.size() && starts_with( target, from ) )
+			return { error::none };
+
+		// Keep the moved value in a separate document, removing it invalidates 'v'
+		document moved( _doc.resource() );
+		moved = editor::empty_array();
+		editor( moved ).push_back( moved, v );
+
+		if ( auto err = remove( from ) )
+			return err;
+
+		return add( target, moved[0] );
+	}
+
+	return { error::invalid_patch };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool patcher::array_index( const path &p, size_t i, size_t size, size_t &out ) noexcept
+{
+	// "-" references the element past the end of the array
+	out = ( p[i] == "-" ) ? size : p.index( i );
+	return out != pointer::npos;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool patcher::starts_with( const path &p, const path &prefix ) noexcept
+{
+	for ( size_t i = 0; i < prefix.size(); ++i )
+		if ( i >= p.size() || p[i] != prefix[i] )
+			return false;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::add( const path &p, const value &v )
+{
+	if ( p.empty() )
+		return { _editor.assign( v ) ? error::none : error::invalid_root };
+
+	value parent;
+	if ( !p.find( _doc, parent, p.size() - 1 ) )
+		return { error::path_not_found };
+
+	if ( parent.is_object() )
+		_editor.set( parent, p[p.size() - 1], v );
+	else if ( size_t index = 0; parent.is_array() && array_index( p, p.size() - 1, array_view( parent ).size(), index ) && index <= array_view( parent ).size() )
+		_editor.insert( parent, index, v );
+	else
+		return { error::path_not_found };
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::remove( const path &p )
+{
+	if ( p.empty() )
+		return { error::invalid_patch };
+
+	value parent;
+	if ( !p.find( _doc, parent, p.size() - 1 ) )
+		return { error::path_not_found };
+
+	if ( parent.is_object() && _editor.erase( parent, p[p.size() - 1] ) )
+		return { error::none };
+	else if ( size_t index = 0; parent.is_array() && array_index( p, p.size() - 1, array_view( parent ).size(), index ) && _editor.erase( parent, index ) )
+		return { error::none };
+
+	return { error::path_not_found };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error patcher::replace( const path &p, const value &v )
+{
+	value current;
+	if ( !p.find( _doc, current ) )
+		return { error::path_not_found };
+
+	if ( p.empty() )
+		return { _editor.assign( v ) ? error::none : error::invalid_root };
+
+	value parent;
+	p.find( _doc, parent, p.size() - 1 );
+
+	if ( parent.is_object() )
+		_editor.set( parent, p[p.size() - 1], v );
+	else if ( size_t index = 0; array_index( p, p.size() - 1, array_view( parent ).size(), index ) )
+		_editor.set( parent, index, v );
+
+	return { error::none };
+}
+
+/*
+	Builds JSON patch while walking both values. Identical subtrees are skipped by value
+	comparison, which returns early for shared containers and rejects different structural
+	hashes in O(1). Object keys are matched by 'object_view::find' (hash index of large objects).
+*/
+class differ final
+{
+public:
+	differ( document &patch ) : _builder( patch ) { }
+
+	void diff( const value &a, const value &b );
+
+private:
+	void diff_value( const value &a, const value &b );
+	void diff_object( const object_view &a, const object_view &b );
+	void diff_array( const array_view &a, const array_view &b );
+	void add_operation( std::string_view op, const value *v );
+
+	void push_path( std::string_view key );
+	void push_path( size_t index ) { _path += '/'; _path += std::to_string( index ); }
+
+	builder _builder;
+	std::string _path;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::diff( const value &a, const value &b )
+{
+	_path.clear();
+	_builder.push_array();
+	diff_value( a, b );
+	_builder.pop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::diff_value( const value &a, const value &b )
+{
+	if ( a == b )
+		return;
+	else if ( a.is_object() && b.is_object() )
+		diff_object( object_view( a ), object_view( b ) );
+	else if ( a.is_array() && b.is_array() )
+		diff_array( array_view( a ), array_view( b ) );
+	else
+		add_operation( "replace", &b );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::diff_object( const object_view &a, const object_view &b )
+{
+	const size_t pathSize = _path.size();
+
+	for ( auto kvp : a )
+	{
+		push_path( kvp.first );
+
+		if ( const auto iter = b.find( kvp.first ); iter == b.end() )
+			add_operation( "remove", nullptr );
+		else
+			diff_value( kvp.second, ( *iter ).second );
+
+		_path.resize( pathSize );
+	}
+
+	for ( auto kvp : b )
+	{
+		if ( a.find( kvp.first ) == a.end() )
+		{
+			push_path( kvp.first );
+			add_operation( "add", &kvp.second );
+			_path.resize( pathSize );
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::diff_array( const array_view &a, const array_view &b )
+{
+	const size_t pathSize = _path.size();
+
+	// Skip common prefix and suffix, so single insertions and removals are found
+	size_t prefix = 0, suffix = 0;
+	while ( prefix < a.size() && prefix < b.size() && a[prefix] == b[prefix] )
+		++prefix;
+
+	while ( suffix < a.size() - prefix && suffix < b.size() - prefix && a[a.size() - suffix - 1] == b[b.size() - suffix - 1] )
+		++suffix;
+
+	const size_t countA = a.size() - prefix - suffix, countB = b.size() - prefix - suffix;
+	const size_t common = std::min( countA, countB );
+
+	for ( size_t i = prefix; i < prefix + common; ++i )
+	{
+		push_path( i );
+		diff_value( a[i], b[i] );
+		_path.resize( pathSize );
+	}
+
+	for ( size_t i = common; i < countA; ++i )
+	{
+		push_path( prefix + common );
+		add_operation( "remove", nullptr );
+		_path.resize( pathSize );
+	}
+
+	for ( size_t i = prefix + common; i < prefix + countB; ++i )
+	{
+		push_path( i );
+		auto item = b[i];
+		add_operation( "add", &item );
+		_path.resize( pathSize );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::add_operation( std::string_view op, const value *v )
+{
+	_builder.push_object();
+	_builder["op"] = _builder.new_string( op );
+	_builder["path"] = _builder.new_string( _path );
+
+	if ( v )
+		_builder["value"] = _builder.import( *v );
+
+	_builder += _builder.pop();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void differ::push_path( std::string_view key )
+{
+	_path += '/';
+
+	for ( char ch : key )
+	{
+		if ( ch == '~' )
+			_path += "~0";
+		else if ( ch == '/' )
+			_path += "~1";
+		else
+			_path += ch;
+	}
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error apply_merge_patch( document &doc, const value &patch )
+{
+	editor e( doc );
+	return apply_merge_patch( e, patch );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error apply_merge_patch( editor &e, const value &patch )
+{
+	return detail::patcher( e ).merge( patch );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error apply_patch( document &doc, const value &patch )
+{
+	editor e( doc );
+	return apply_patch( e, patch );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error apply_patch( editor &e, const value &patch )
+{
+	return detail::patcher( e ).apply( patch );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline document diff( const value &a, const value &b )
+{
+	document result;
+	detail::differ( result ).diff( a, b );
+	return result;
+}
+
+} // namespace json5
@@ -0,0 +1,321 @@
+#pragma once
+
+#include "json5.hpp"
+
+namespace json5 {
+
+class pointer;
+
+// Resolve 'count' pointers against 'root' in one traversal (values shared by common prefixes of the
+// pointers are looked up once). Not found values are stored in 'results' as null.
+void resolve( const value &root, const pointer *pointers, size_t count, value *results );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::pointer
+
+Compiled JSON Pointer (RFC 6901) or dot path. The string is split and unescaped once, array
+indices are parsed and object keys are stored as json5::key (with precomputed hash and cached
+position of the last match), so resolving a pointer does no string processing.
+
+*/
+class pointer final
+{
+public:
+	// Token is not a valid array index
+	static constexpr size_t npos = size_t( -1 );
+
+	// Construct empty pointer (references the whole document)
+	pointer() noexcept = default;
+
+	// Construct pointer from JSON Pointer string (invalid pointer, if the string is not valid)
+	explicit pointer( std::string_view str ) { assign( str ); }
+
+	pointer( const pointer &copy ) : _names( copy._names ), _tokens( copy._tokens ), _valid( copy._valid ) { bind(); }
+	pointer( pointer &&rValue ) noexcept = default;
+	pointer &operator=( const pointer &copy );
+	pointer &operator=( pointer &&rValue ) noexcept = default;
+
+	// Compile JSON Pointer, e.g. "/statuses/0/user/id" ('~0' and '~1' escape '~' and '/')
+	error assign( std::string_view str );
+
+	// Compile dot path, e.g. "statuses[0].user.id", "statuses.0.user.id" or "map['key.with.dots']"
+	error assign_path( std::string_view path );
+
+	// Checks, if pointer was compiled without error
+	bool is_valid() const noexcept { return _valid; }
+
+	// Get number of reference tokens
+	size_t size() const noexcept { return _tokens.size(); }
+
+	bool empty() const noexcept { return _tokens.empty(); }
+
+	// Get unescaped reference token at 'i'
+	std::string_view operator[]( size_t i ) const noexcept { return _tokens[i].name.name(); }
+
+	// Get array index of reference token at 'i' ('npos', if the token is not a valid array index)
+	size_t index( size_t i ) const noexcept { return _tokens[i].index; }
+
+	// Find referenced value (following only first 'depth' tokens, if specified). Returns false,
+	// if the value does not exist.
+	bool find( const value &root, value &out, size_t depth = npos ) const noexcept;
+
+	// Get referenced value (null, if it does not exist)
+	value resolve( const value &root ) const noexcept;
+
+private:
+	struct token
+	{
+		size_t offset = 0;
+		size_t length = 0;
+		size_t index = npos;
+		key name = key( std::string_view() );
+	};
+
+	void add_token( size_t offset );
+	void bind() noexcept;
+	error make_error( size_t position ) noexcept;
+	static bool step( value &v, const token &t ) noexcept;
+
+	// Unescaped tokens one after another (a vector keeps its buffer when moved, unlike short strings)
+	std::vector<char> _names;
+	std::vector<token> _tokens;
+	bool _valid = true;
+
+	friend void resolve( const value &root, const pointer *pointers, size_t count, value *results );
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline pointer &pointer::operator=( const pointer &copy )
+{
+	_names = copy._names;
+	_tokens = copy._tokens;
+	_valid = copy._valid;
+	bind();
+	return *this;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error pointer::assign( std::string_view str )
+{
+	_names.clear();
+	_tokens.clear();
+	_valid = true;
+
+	if ( str.empty() )
+		return { error::none };
+	else if ( str[0] != '/' )
+		return make_error( 0 );
+
+	size_t offset = 0;
+
+	for ( size_t i = 1; i < str.size(); ++i )
+	{
+		if ( str[i] == '/' )
+		{
+			add_token( offset );
+			offset = _names.size();
+		}
+		else if ( str[i] != '~' )
+			_names.push_back( str[i] );
+		else if ( i + 1 < str.size() && ( str[i + 1] == '0' || str[i + 1] == '1' ) )
+			_names.push_back( ( str[++i] == '0' ) ? '~' : '/' );
+		else
+			return make_error( i );
+	}
+
+	add_token( offset );
+	bind();
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error pointer::assign_path( std::string_view path )
+{
+	_names.clear();
+	_tokens.clear();
+	_valid = true;
+
+	for ( size_t i = 0; i < path.size(); )
+	{
+		const size_t offset = _names.size();
+
+		if ( path[i] == '[' )
+		{
+			// Bracket holds an array index or a quoted key
+			const char quote = ( i + 1 < path.size() && ( path[i + 1] == '\'' || path[i + 1] == '"' ) ) ? path[i + 1] : 0;
+			const size_t first = i + ( quote ? 2 : 1 );
+			const size_t last = path.find( quote ? quote : ']', first );
+
+			if ( last == std::string_view::npos || ( quote && ( last + 1 >= path.size() || path[last + 1] != ']' ) ) || ( !quote && last == first ) )
+				return make_error( i );
+
+			_names.insert( _names.end(), path.begin() + first, path.begin() + last );
+			i = last + ( quote ? 2 : 1 );
+		}
+		else
+		{
+			if ( !_tokens.empty() )
+			{
+				if ( path[i] != '.' )
+					return make_error( i );
+
+				++i;
+			}
+
+			const size_t last = std::min( path.find_first_of( ".[", i ), path.size() );
+			if ( last == i )
+				return make_error( i );
+
+			_names.insert( _names.end(), path.begin() + i, path.begin() + last );
+			i = last;
+		}
+
+		add_token( offset );
+	}
+
+	bind();
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool pointer::find( const value &root, value &out, size_t depth ) const noexcept
+{
+	if ( !_valid )
+		return false;
+
+	out = root;
+
+	for ( size_t i = 0, S = std::min( depth, _tokens.size() ); i < S; ++i )
+		if ( !step( out, _tokens[i] ) )
+			return false;
+
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline value pointer::resolve( const value &root ) const noexcept
+{
+	value result;
+	return find( root, result ) ? result : value();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void pointer::add_token( size_t offset )
+{
+	token t;
+	t.offset = offset;
+	t.length = _names.size() - offset;
+
+	// Array index is a number without leading zeros
+	const char *digits = _names.data() + offset;
+	if ( t.length > 0 && ( digits[0] != '0' || t.length == 1 ) )
+	{
+		t.index = 0;
+
+		for ( size_t i = 0; i < t.length && t.index != npos; ++i )
+			t.index = ( digits[i] >= '0' && digits[i] <= '9' && t.index < npos / 10 - 1 ) ? t.index * 10 + ( digits[i] - '0' ) : npos;
+	}
+
+	_tokens.push_back( t );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void pointer::bind() noexcept
+{
+	// Keys reference the names buffer, which might have been reallocated or copied
+	for ( auto &t : _tokens )
+		t.name = key( std::string_view( _names.data() + t.offset, t.length ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error pointer::make_error( size_t position ) noexcept
+{
+	_names.clear();
+	_tokens.clear();
+	_valid = false;
+	return { error::syntax_error, 1, position + 1 };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline bool pointer::step( value &v, const token &t ) noexcept
+{
+	if ( v.is_object() )
+	{
+		const object_view ov( v );
+		const auto iter = ov.find( t.name );
+		if ( iter == ov.end() )
+			return false;
+
+		v = ( *iter ).second;
+	}
+	else if ( v.is_array() )
+	{
+		const array_view av( v );
+		if ( t.index >= av.size() )
+			return false;
+
+		v = av[t.index];
+	}
+	else
+		return false;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void resolve( const value &root, const pointer *pointers, size_t count, value *results )
+{
+	// Pointers are visited in sorted order, so every pointer continues from the value resolved for
+	// its common prefix with the previous one
+	std::vector<size_t> order( count );
+	for ( size_t i = 0; i < count; ++i )
+		order[i] = i;
+
+	const auto tokenLess = []( const pointer::token &a, const pointer::token &b ) { return a.name.name() < b.name.name(); };
+	std::sort( order.begin(), order.end(), [&]( size_t a, size_t b )
+	{
+		const auto &ta = pointers[a]._tokens, &tb = pointers[b]._tokens;
+		return std::lexicographical_compare( ta.begin(), ta.end(), tb.begin(), tb.end(), tokenLess );
+	} );
+
+	// Values resolved for the tokens of the previous pointer ('path[0]' is the root)
+	std::vector<value> path( 1, root );
+	const pointer *prev = nullptr;
+
+	for ( size_t i : order )
+	{
+		const pointer &p = pointers[i];
+		results[i] = value();
+
+		if ( !p._valid )
+			continue;
+
+		size_t common = 0;
+		while ( prev && common + 1 < path.size() && common < p.size() && ( *prev )[common] == p[common] )
+			++common;
+
+		path.resize( common + 1 );
+		prev = &p;
+
+		value v = path.back();
+		bool found = true;
+
+		for ( size_t t = common; t < p.size() && found; ++t )
+		{
+			if ( ( found = pointer::step( v, p._tokens[t] ) ) )
+				path.push_back( v );
+		}
+
+		if ( found )
+			results[i] = v;
+	}
+}
+
+} // namespace json5
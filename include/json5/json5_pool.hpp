@@ -0,0 +1,170 @@
+#pragma once
+
+#include "json5.hpp"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace json5 {
+
+/*
+
+json5::document_pool
+
+Thread-safe recycler of json5::document instances. Released documents are cleared, but keep
+their buffers, so parsing into them again (e.g. with 'from_string') does not allocate once
+the buffers are warmed up. Documents are cached in several shards selected by the calling
+thread, so threads acquiring and releasing documents rarely contend for the same lock.
+
+Documents reserving more than 'maxRetainedBytes' are trimmed on release, so a single huge
+payload does not pin its memory forever. The pool must outlive all its handles.
+
+*/
+class document_pool final
+{
+public:
+	class handle;
+
+	document_pool( size_t maxCachedDocuments = 64, size_t maxRetainedBytes = 1024 * 1024,
+	               std::pmr::memory_resource *resource = std::pmr::get_default_resource() )
+		: _maxCachedDocuments( maxCachedDocuments )
+		, _maxRetainedBytes( maxRetainedBytes )
+		, _resource( resource )
+	{ }
+
+	document_pool( const document_pool & ) = delete;
+	document_pool &operator=( const document_pool & ) = delete;
+
+	// Get empty document from the pool (or create a new one)
+	handle acquire();
+
+	// Number of documents currently cached in the pool
+	size_t size() const;
+
+	// Release all cached documents
+	void clear();
+
+private:
+	void release( std::unique_ptr<document> doc );
+	size_t shard_index() const noexcept { return std::hash<std::thread::id>()( std::this_thread::get_id() ) % shard_count; }
+
+	// Shards split 'maxCachedDocuments' between them, so the pool never caches more in total
+	size_t shard_capacity( size_t index ) const noexcept { return _maxCachedDocuments / shard_count + ( index < _maxCachedDocuments % shard_count ); }
+
+	static constexpr size_t shard_count = 8;
+
+	struct shard
+	{
+		mutable std::mutex mutex;
+		std::vector<std::unique_ptr<document>> documents;
+	};
+
+	shard _shards[shard_count];
+	size_t _maxCachedDocuments = 0;
+	size_t _maxRetainedBytes = 0;
+	std::pmr::memory_resource *_resource = nullptr;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+class document_pool::handle final
+{
+public:
+	handle() noexcept = default;
+	handle( handle &&other ) noexcept : _pool( other._pool ), _doc( std::move( other._doc ) ) { }
+	handle &operator=( handle &&other ) noexcept { reset(); _pool = other._pool; _doc = std::move( other._doc ); return *this; }
+	~handle() { reset(); }
+
+	document &operator*() const noexcept { return *_doc; }
+	document *operator->() const noexcept { return _doc.get(); }
+	document *get() const noexcept { return _doc.get(); }
+
+	explicit operator bool() const noexcept { return _doc != nullptr; }
+
+	// Return document back to the pool
+	void reset() { if ( _doc ) _pool->release( std::move( _doc ) ); }
+
+private:
+	handle( document_pool *pool, std::unique_ptr<document> doc ) noexcept : _pool( pool ), _doc( std::move( doc ) ) { }
+
+	document_pool *_pool = nullptr;
+	std::unique_ptr<document> _doc;
+
+	friend document_pool;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline document_pool::handle document_pool::acquire()
+{
+	const size_t first = shard_index();
+
+	// Try own shard first, then steal from the others
+	for ( size_t i = 0; i < shard_count; ++i )
+	{
+		auto &s = _shards[( first + i ) % shard_count];
+		std::lock_guard<std::mutex> lock( s.mutex );
+
+		if ( !s.documents.empty() )
+		{
+			auto doc = std::move( s.documents.back() );
+			s.documents.pop_back();
+			return handle( this, std::move( doc ) );
+		}
+	}
+
+	return handle( this, std::make_unique<document>( _resource ) );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t document_pool::size() const
+{
+	size_t result = 0;
+	for ( const auto &s : _shards )
+	{
+		std::lock_guard<std::mutex> lock( s.mutex );
+		result += s.documents.size();
+	}
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void document_pool::clear()
+{
+	for ( auto &s : _shards )
+	{
+		std::lock_guard<std::mutex> lock( s.mutex );
+		s.documents.clear();
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void document_pool::release( std::unique_ptr<document> doc )
+{
+	// Trimmed documents are replaced (moving an empty document in may keep the string buffer)
+	if ( doc->reserved_bytes() > _maxRetainedBytes )
+		doc = std::make_unique<document>( _resource );
+	else
+		doc->clear();
+
+	const size_t first = shard_index();
+
+	// Try own shard first, then the others (document is destroyed, when all of them are full)
+	for ( size_t i = 0; i < shard_count; ++i )
+	{
+		const size_t index = ( first + i ) % shard_count;
+		auto &s = _shards[index];
+		std::lock_guard<std::mutex> lock( s.mutex );
+
+		if ( s.documents.size() < shard_capacity( index ) )
+		{
+			s.documents.push_back( std::move( doc ) );
+			return;
+		}
+	}
+}
+
+} // namespace json5
@@ -85,10 +85,15 @@ inline json5::value write( writer &w, const std::string &in ) { return w.new_str
 template <typename T>
 inline json5::value write_array( writer &w, const T *in, size_t numItems )
 {
-	w.push_array();
+	w.push_array( numItems );
 
-	for ( size_t i = 0; i < numItems; ++i )
-		w += write( w, in[i] );
+	if constexpr ( std::is_same_v<T, double> )
+		w.add_numbers( in, numItems );
+	else
+	{
+		for ( size_t i = 0; i < numItems; ++i )
+			w += write( w, in[i] );
+	}
 
 	return w.pop();
 }
@@ -236,7 +241,7 @@ inline error read( const json5::value &in, std::string &out )
 	if ( !in.is_string() )
 		return { error::string_expected };
 
-	out = in.get_c_str();
+	out = in.get_string_view();
 	return { error::none };
 }
 
@@ -332,7 +337,7 @@ inline error read_enum( const json5::value &in, T &out )
 		if ( name.empty() )
 			break;
 
-		if ( in.is_string() && name == in.get_c_str() )
+		if ( in.is_string() && name == in.get_string_view() )
 		{
 			out = values[index];
 			return { error::none };
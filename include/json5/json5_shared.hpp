@@ -0,0 +1,96 @@
+#pragma once
+
+#include "json5.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace json5 {
+
+/*
+
+json5::shared_document
+
+Reference-counted immutable document. Copying a shared_document only increments the reference
+count, the document is never copied or relinked. Values and views obtained from it stay valid
+while any copy is alive.
+
+Reading the same document from several threads at once is safe: value access, object_view,
+array_view, equality, hashing (including stale hashes of edited documents), json5::filter and
+output never write to the document. json5::key and json5::pointer cache lookup positions, so
+every thread should use its own instances of those.
+
+The document's memory resource must allow deallocation from any thread, as the last reference
+might be released by any reader.
+
+*/
+class shared_document final
+{
+public:
+	// Construct null shared document
+	shared_document() noexcept = default;
+
+	// Take over 'doc' (its buffers are moved, not copied)
+	explicit shared_document( document &&doc ) : _doc( std::make_shared<const document>( std::move( doc ) ) ) { }
+
+	// Construct from a copy of 'doc'
+	explicit shared_document( const document &doc ) : _doc( std::make_shared<const document>( doc ) ) { }
+
+	// Checks, if there is a document
+	explicit operator bool() const noexcept { return _doc != nullptr; }
+
+	const document &operator*() const noexcept { return *_doc; }
+	const document *operator->() const noexcept { return _doc.get(); }
+	const document *get() const noexcept { return _doc.get(); }
+
+	// Number of shared_document instances referencing the document
+	long use_count() const noexcept { return _doc.use_count(); }
+
+private:
+	explicit shared_document( std::shared_ptr<const document> doc ) noexcept : _doc( std::move( doc ) ) { }
+
+	std::shared_ptr<const document> _doc;
+
+	friend class atomic_shared_document;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::atomic_shared_document
+
+Holds the current version of a shared document (e.g. configuration), which writers replace
+atomically, RCU-style. Readers 'load' the current version and keep using it, while a writer
+publishes a new one. The old version is freed once its last reader is done with it.
+
+*/
+class atomic_shared_document final
+{
+public:
+	atomic_shared_document() noexcept = default;
+	explicit atomic_shared_document( shared_document doc ) noexcept : _doc( std::move( doc._doc ) ) { }
+
+	atomic_shared_document( const atomic_shared_document & ) = delete;
+	atomic_shared_document &operator=( const atomic_shared_document & ) = delete;
+
+	// Get current version
+	shared_document load() const noexcept { return shared_document( _doc.load( std::memory_order_acquire ) ); }
+
+	// Replace current version
+	void store( shared_document doc ) noexcept { _doc.store( std::move( doc._doc ), std::memory_order_release ); }
+
+	// Replace current version with 'doc' (buffers are moved, not copied)
+	void publish( document &&doc ) { store( shared_document( std::move( doc ) ) ); }
+
+	// Replace current version, returns the previous one
+	shared_document exchange( shared_document doc ) noexcept
+	{
+		return shared_document( _doc.exchange( std::move( doc._doc ), std::memory_order_acq_rel ) );
+	}
+
+private:
+	std::atomic<std::shared_ptr<const document>> _doc;
+};
+
+} // namespace json5
@@ -0,0 +1,224 @@
+#pragma once
+
+#include "json5.hpp"
+
+#include <unordered_set>
+
+namespace json5 {
+
+//---------------------------------------------------------------------------------------------------------------------
+struct document_stats
+{
+	// Bytes used and reserved by document buffers. Used value bytes include container headers,
+	// hash indices and slots left behind by json5::editor (until 'compact').
+	size_t value_bytes = 0;
+	size_t value_reserved_bytes = 0;
+	size_t string_bytes = 0;
+	size_t string_reserved_bytes = 0;
+
+	// Number of values of each type (indexed by 'value_type') and number of object keys
+	size_t counts[6] = { };
+	size_t keys = 0;
+
+	// Maximum nesting depth (0 for a scalar document, 1 for a flat object or array)
+	size_t max_depth = 0;
+
+	// Number of key-value pairs of the largest object and elements of the largest array
+	size_t largest_object = 0;
+	size_t largest_array = 0;
+
+	// Bytes of strings and keys (without length prefix and '\0'), which repeat an earlier one
+	size_t duplicate_string_bytes = 0;
+	double duplicate_string_ratio = 0.0;
+
+	size_t count( value_type type ) const noexcept { return counts[size_t( type )]; }
+	size_t used_bytes() const noexcept { return value_bytes + string_bytes; }
+	size_t reserved_bytes() const noexcept { return value_reserved_bytes + string_reserved_bytes; }
+};
+
+// Get memory statistics of json5::document (walks the whole document)
+document_stats stats( const document &doc );
+
+// Estimate number of bytes used by json5::document parsed from 'input' (scans the input once
+// without parsing or allocating, the result is usually within a few percent)
+size_t estimate_footprint( std::string_view input ) noexcept;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+//---------------------------------------------------------------------------------------------------------------------
+class statistics final
+{
+public:
+	static document_stats collect( const document &doc );
+	static size_t estimate( std::string_view input ) noexcept;
+
+private:
+	statistics( document_stats &result ) : _result( result ) { }
+
+	void walk( const value &v, size_t depth );
+	void add_string( std::string_view str );
+
+	document_stats &_result;
+	std::unordered_set<std::string_view> _strings;
+	size_t _stringBytes = 0;
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+inline document_stats statistics::collect( const document &doc )
+{
+	document_stats result;
+	result.value_bytes = doc._values.size() * sizeof( value );
+	result.value_reserved_bytes = doc._values.capacity() * sizeof( value );
+	result.string_bytes = doc._strings.size();
+	result.string_reserved_bytes = doc._strings.capacity();
+
+	statistics walker( result );
+	walker.walk( doc, 0 );
+
+	if ( walker._stringBytes )
+		result.duplicate_string_ratio = double( result.duplicate_string_bytes ) / double( walker._stringBytes );
+
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t statistics::estimate( std::string_view input ) noexcept
+{
+	/*
+		Every object and array takes a header, every element a slot and every key one more slot.
+		Elements are counted by commas (plus the last element of every container, assuming no
+		trailing commas), keys by colons. Keys of objects nested up to 'trackedDepth' are counted
+		per object, to add the hash index of large objects. Every string and key takes its chars,
+		length prefix and '\0'. Escape sequences are counted as their length in the input.
+	*/
+	constexpr size_t trackedDepth = 64;
+	size_t objectKeys[trackedDepth] = { }, depth = 0, indexSlots = 0;
+
+	size_t containers = 0, commas = 0, keys = 0, strings = 0, stringChars = 0, identChars = 0;
+	bool prevSpace = false;
+
+	for ( size_t i = 0, S = input.size(); i < S; ++i )
+	{
+		const char ch = input[i];
+
+		if ( ch == '"' || ch == '\'' )
+		{
+			size_t end = i + 1;
+			while ( end < S && input[end] != ch )
+				end += ( input[end] == '\\' ) ? 2 : 1;
+
+			++strings;
+			stringChars += std::min( end, S ) - i - 1;
+			i = end;
+			identChars = 0;
+		}
+		else if ( ch == '/' && i + 1 < S && ( input[i + 1] == '/' || input[i + 1] == '*' ) )
+		{
+			// Skip comments
+			const auto end = input.find( ( input[i + 1] == '/' ) ? "\n" : "*/", i + 2 );
+			i = ( end == std::string_view::npos ) ? S : end;
+		}
+		else if ( ch == '{' || ch == '[' )
+		{
+			if ( ++depth < trackedDepth )
+				objectKeys[depth] = 0;
+
+			++containers;
+		}
+		else if ( ch == '}' || ch == ']' )
+		{
+			if ( depth > 0 && depth < trackedDepth )
+				indexSlots += value::index_size( objectKeys[depth] );
+
+			depth -= ( depth > 0 ) ? 1 : 0;
+		}
+		else if ( ch == ',' )
+			++commas;
+		else if ( ch == ':' )
+		{
+			// Unquoted key is the identifier right before the colon
+			++keys;
+
+			if ( depth < trackedDepth )
+				++objectKeys[depth];
+
+			if ( identChars )
+			{
+				++strings;
+				stringChars += identChars;
+			}
+		}
+
+		const bool isSpace = ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+		if ( ch == '_' || ch == '$' || ( ch >= 'a' && ch <= 'z' ) || ( ch >= 'A' && ch <= 'Z' ) || ( ch >= '0' && ch <= '9' ) )
+			identChars = prevSpace ? 1 : identChars + 1;
+		else if ( !isSpace )
+			identChars = 0;
+
+		prevSpace = isSpace;
+	}
+
+	const size_t values = value::base_size + containers * value::header_size + commas + containers + keys + indexSlots;
+	const size_t stringSize = sizeof( detail::string_length ) + 1 + strings * ( sizeof( detail::string_length ) + 1 ) + stringChars;
+	return values * sizeof( value ) + stringSize;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void statistics::walk( const value &v, size_t depth )
+{
+	_result.counts[size_t( v.type() )]++;
+
+	if ( v.is_string() )
+		add_string( v.get_string_view() );
+	else if ( v.is_object() )
+	{
+		const object_view ov( v );
+		_result.keys += ov.size();
+		_result.largest_object = std::max( _result.largest_object, ov.size() );
+		_result.max_depth = std::max( _result.max_depth, depth + 1 );
+
+		for ( auto kvp : ov )
+		{
+			add_string( std::string_view( kvp.first, value::string_length( kvp.first ) ) );
+			walk( kvp.second, depth + 1 );
+		}
+	}
+	else if ( v.is_array() )
+	{
+		const array_view av( v );
+		_result.largest_array = std::max( _result.largest_array, av.size() );
+		_result.max_depth = std::max( _result.max_depth, depth + 1 );
+
+		for ( auto item : av )
+			walk( item, depth + 1 );
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline void statistics::add_string( std::string_view str )
+{
+	_stringBytes += str.size();
+
+	if ( !_strings.insert( str ).second )
+		_result.duplicate_string_bytes += str.size();
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline document_stats stats( const document &doc )
+{
+	return detail::statistics::collect( doc );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline size_t estimate_footprint( std::string_view input ) noexcept
+{
+	return detail::statistics::estimate( input );
+}
+
+} // namespace json5
@@ -0,0 +1,322 @@
+#pragma once
+
+#include "json5_input.hpp"
+#include "json5_output.hpp"
+
+namespace json5 {
+
+// Transcode JSON5 from stream directly into output stream, without building a document
+error transcode( std::istream &is, std::ostream &os, const writer_params &wp = writer_params() );
+
+// Transcode JSON5 string directly into output stream, without building a document
+error transcode( std::string_view str, std::ostream &os, const writer_params &wp = writer_params() );
+
+// Transcode JSON5 string into 'out' (written straight into the string, reusing its capacity)
+error transcode( std::string_view str, std::string &out, const writer_params &wp = writer_params() );
+
+// Transcode JSON5 file into another file, without loading the whole input into memory
+error transcode_file( std::string_view inFileName, std::string_view outFileName, const writer_params &wp = writer_params() );
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+
+json5::transcoder
+
+Reads JSON5 tokens from a char source and writes them straight to a char sink,
+using the same formatting as 'to_stream'. Only the currently processed string or key
+is buffered, so memory usage does not depend on the size of the input. On error,
+the output contains everything written before the error was detected.
+
+*/
+class transcoder final
+{
+public:
+	transcoder( detail::char_source &chars, detail::char_sink &out, const writer_params &wp = writer_params() )
+		: _lexer( _scratch, chars ), _out( out ), _params( wp ) { }
+
+	error transcode();
+
+private:
+	using token_type = parser::token_type;
+
+	error transcode_value( int depth );
+	error transcode_object( int depth );
+	error transcode_array( int depth );
+
+	void write_eol() { if ( !_params.compact ) _out.write( _params.eol ); }
+	void write_indent( int depth ) { if ( !_params.compact ) detail::write_indent( _out, _params.indentation, depth ); }
+
+	document _scratch;
+	parser _lexer;
+	detail::char_sink &_out;
+	writer_params _params;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcoder::transcode()
+{
+	_lexer.reset();
+
+	token_type tt = token_type::unknown;
+	if ( auto err = _lexer.peek_next_token( tt ) )
+		return err;
+
+	if ( tt != token_type::object_begin && tt != token_type::array_begin )
+		return _lexer.make_error( error::invalid_root );
+
+	if ( auto err = transcode_value( 0 ) )
+		return err;
+
+	write_eol();
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcoder::transcode_value( int depth )
+{
+	token_type tt = token_type::unknown;
+	if ( auto err = _lexer.peek_next_token( tt ) )
+		return err;
+
+	switch ( tt )
+	{
+		case token_type::number:
+		{
+			if ( double number = 0.0; auto err = _lexer.parse_number( number ) )
+				return err;
+			else
+				_out.write_number( number );
+		}
+		break;
+
+		case token_type::string:
+		{
+			if ( detail::string_offset offset = 0; auto err = _lexer.parse_string( offset ) )
+				return err;
+			else
+				detail::write_string( _out, _lexer.string_buffer_view( offset ), '"', _params.escape_unicode );
+
+			_lexer.reset();
+		}
+		break;
+
+		case token_type::identifier:
+		{
+			if ( token_type lit = token_type::unknown; auto err = _lexer.parse_literal( lit ) )
+				return err;
+			else
+			{
+				if ( lit == token_type::literal_true )
+					_out.write( "true" );
+				else if ( lit == token_type::literal_false )
+					_out.write( "false" );
+				else if ( lit == token_type::literal_null )
+					_out.write( "null" );
+				else
+					return _lexer.make_error( error::invalid_literal );
+			}
+		}
+		break;
+
+		case token_type::object_begin:
+			return transcode_object( depth );
+
+		case token_type::array_begin:
+			return transcode_array( depth );
+
+		default:
+			return _lexer.make_error( error::syntax_error );
+	}
+
+	return { error::none };
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcoder::transcode_object( int depth )
+{
+	_lexer.next(); // Consume '{'
+
+	bool expectComma = false;
+	size_t count = 0;
+	while ( !_lexer.eof() )
+	{
+		token_type tt = token_type::unknown;
+		if ( auto err = _lexer.peek_next_token( tt ) )
+			return err;
+
+		detail::string_offset keyOffset;
+
+		switch ( tt )
+		{
+			case token_type::identifier:
+			case token_type::string:
+			{
+				if ( expectComma )
+					return _lexer.make_error( error::comma_expected );
+
+				if ( auto err = _lexer.parse_identifier( keyOffset ) )
+					return err;
+			}
+			break;
+
+			case token_type::object_end:
+			{
+				_lexer.next(); // Consume '}'
+
+				if ( count )
+				{
+					write_eol();
+					write_indent( depth );
+					_out.put( '}' );
+				}
+				else
+					_out.write( "{}" );
+
+				return { error::none };
+			}
+
+			case token_type::comma:
+				if ( !expectComma )
+					return _lexer.make_error( error::syntax_error );
+
+				_lexer.next(); // Consume ','
+				expectComma = false;
+				continue;
+
+			default:
+				return expectComma ? _lexer.make_error( error::comma_expected ) : _lexer.make_error( error::syntax_error );
+		}
+
+		_out.put( count++ ? ',' : '{' );
+		write_eol();
+		write_indent( depth + 1 );
+
+		if ( _params.json_compatible )
+		{
+			_out.put( '"' );
+			_out.write( _lexer.string_buffer_view( keyOffset ) );
+			_out.put( '"' );
+		}
+		else
+			_out.write( _lexer.string_buffer_view( keyOffset ) );
+
+		_out.write( _params.compact ? ":" : ": " );
+		_lexer.reset();
+
+		if ( auto err = _lexer.peek_next_token( tt ) )
+			return err;
+
+		if ( tt != token_type::colon )
+			return _lexer.make_error( error::colon_expected );
+
+		_lexer.next(); // Consume ':'
+
+		if ( auto err = transcode_value( depth + 1 ) )
+			return err;
+
+		_out.commit();
+		expectComma = true;
+	}
+
+	return _lexer.make_error( error::unexpected_end );
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcoder::transcode_array( int depth )
+{
+	_lexer.next(); // Consume '['
+
+	bool expectComma = false;
+	size_t count = 0;
+	while ( !_lexer.eof() )
+	{
+		token_type tt = token_type::unknown;
+		if ( auto err = _lexer.peek_next_token( tt ) )
+			return err;
+
+		if ( tt == token_type::array_end && _lexer.next() ) // Consume ']'
+		{
+			if ( count )
+			{
+				write_eol();
+				write_indent( depth );
+				_out.put( ']' );
+			}
+			else
+				_out.write( "[]" );
+
+			return { error::none };
+		}
+		else if ( expectComma )
+		{
+			expectComma = false;
+
+			if ( tt != token_type::comma )
+				return _lexer.make_error( error::comma_expected );
+
+			_lexer.next(); // Consume ','
+			continue;
+		}
+
+		_out.put( count++ ? ',' : '[' );
+		write_eol();
+		write_indent( depth + 1 );
+
+		if ( auto err = transcode_value( depth + 1 ) )
+			return err;
+
+		_out.commit();
+		expectComma = true;
+	}
+
+	return _lexer.make_error( error::unexpected_end );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcode( std::istream &is, std::ostream &os, const writer_params &wp )
+{
+	detail::stl_istream src( is );
+	detail::stl_ostream out( os );
+	transcoder t( src, out, wp );
+	return t.transcode();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcode( std::string_view str, std::ostream &os, const writer_params &wp )
+{
+	detail::memory_block src( str.data(), str.size() );
+	detail::stl_ostream out( os );
+	transcoder t( src, out, wp );
+	return t.transcode();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcode( std::string_view str, std::string &out, const writer_params &wp )
+{
+	out.clear();
+	detail::memory_block src( str.data(), str.size() );
+	detail::char_sink sink( out );
+	transcoder t( src, sink, wp );
+	return t.transcode();
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+inline error transcode_file( std::string_view inFileName, std::string_view outFileName, const writer_params &wp )
+{
+	std::ifstream ifs( std::string( inFileName ).c_str() );
+	if ( !ifs.is_open() )
+		return { error::could_not_open };
+
+	std::ofstream ofs( std::string( outFileName ).c_str() );
+	if ( !ofs.is_open() )
+		return { error::could_not_open };
+
+	return transcode( ifs, ofs, wp );
+}
+
+} // namespace json5
@@ -40,3 +40,9 @@ project "test"
 	files { "test/**.cpp", "test/**.hpp", "include/**.hpp", "include/**.inl", "**.natvis" }
 	includedirs { "include" }
 	debugdir "test"
+
+project "embed"
+	language "C++"
+	kind "ConsoleApp"
+	files { "tools/embed.cpp", "include/**.hpp" }
+	includedirs { "include" }
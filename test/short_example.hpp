@@ -0,0 +1,49 @@
+// Generated by json5::to_cpp_header, do not edit
+#pragma once
+
+#include <json5/json5_binary.hpp>
+
+alignas( 8 ) inline constexpr unsigned char short_example_data[] =
+{
+	0x4a, 0x53, 0x35, 0x42, 0x04, 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01, 0x08, 0x00, 0x00, 0x00,
+	0x1b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x23, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x06, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf6, 0xff, 0xd8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x3f,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0xb9, 0x0e, 0xcb, 0xf4, 0x28, 0x74, 0xba, 0xfb,
+	0xf6, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x32, 0x40,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x40, 0xa2, 0xec, 0x6e, 0x9e, 0x0c, 0xee, 0xe9, 0x05,
+	0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff,
+	0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff,
+	0x6b, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x7a, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff,
+	0x92, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x4e, 0x9f, 0x78, 0x29, 0xd0, 0xc2, 0xeb, 0x3f,
+	0xaa, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x00, 0x00, 0x00, 0xa0, 0xfd, 0x8b, 0x60, 0x41,
+	0xba, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf0, 0x3f,
+	0xcb, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0xdd, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff,
+	0xec, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf4, 0xff,
+	0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff, 0x19, 0x01, 0x00, 0x00, 0x00, 0x00, 0xf2, 0xff,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x75, 0x6e, 0x71, 0x75, 0x6f, 0x74, 0x65,
+	0x64, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x61, 0x6e, 0x64, 0x20, 0x79, 0x6f, 0x75, 0x20, 0x63, 0x61,
+	0x6e, 0x20, 0x71, 0x75, 0x6f, 0x74, 0x65, 0x20, 0x6d, 0x65, 0x20, 0x6f, 0x6e, 0x20, 0x74, 0x68,
+	0x61, 0x74, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x73, 0x69, 0x6e, 0x67, 0x6c, 0x65, 0x51, 0x75, 0x6f,
+	0x74, 0x65, 0x73, 0x00, 0x1e, 0x00, 0x00, 0x00, 0x49, 0x20, 0x63, 0x61, 0x6e, 0x20, 0x75, 0x73,
+	0x65, 0x20, 0x22, 0x64, 0x6f, 0x75, 0x62, 0x6c, 0x65, 0x20, 0x71, 0x75, 0x6f, 0x74, 0x65, 0x73,
+	0x22, 0x20, 0x68, 0x65, 0x72, 0x65, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x6c, 0x69, 0x6e, 0x65, 0x42,
+	0x72, 0x65, 0x61, 0x6b, 0x73, 0x00, 0x13, 0x00, 0x00, 0x00, 0x4c, 0x6f, 0x6f, 0x6b, 0x2c, 0x20,
+	0x4d, 0x6f, 0x6d, 0x21, 0x20, 0x4e, 0x6f, 0x20, 0x5c, 0x6e, 0x27, 0x73, 0x21, 0x00, 0x13, 0x00,
+	0x00, 0x00, 0x6c, 0x65, 0x61, 0x64, 0x69, 0x6e, 0x67, 0x44, 0x65, 0x63, 0x69, 0x6d, 0x61, 0x6c,
+	0x50, 0x6f, 0x69, 0x6e, 0x74, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x61, 0x6e, 0x64, 0x54, 0x72, 0x61,
+	0x69, 0x6c, 0x69, 0x6e, 0x67, 0x00, 0x0c, 0x00, 0x00, 0x00, 0x70, 0x6f, 0x73, 0x69, 0x74, 0x69,
+	0x76, 0x65, 0x53, 0x69, 0x67, 0x6e, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x74, 0x72, 0x61, 0x69, 0x6c,
+	0x69, 0x6e, 0x67, 0x43, 0x6f, 0x6d, 0x6d, 0x61, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x69, 0x6e, 0x20,
+	0x6f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x73, 0x00, 0x05, 0x00, 0x00, 0x00, 0x61, 0x6e, 0x64, 0x49,
+	0x6e, 0x00, 0x06, 0x00, 0x00, 0x00, 0x61, 0x72, 0x72, 0x61, 0x79, 0x73, 0x00, 0x13, 0x00, 0x00,
+	0x00, 0x62, 0x61, 0x63, 0x6b, 0x77, 0x61, 0x72, 0x64, 0x73, 0x43, 0x6f, 0x6d, 0x70, 0x61, 0x74,
+	0x69, 0x62, 0x6c, 0x65, 0x00, 0x09, 0x00, 0x00, 0x00, 0x77, 0x69, 0x74, 0x68, 0x20, 0x4a, 0x53,
+	0x4f, 0x4e, 0x00,
+};
+
+inline const json5::snapshot_view &short_example()
+{
+	static const json5::snapshot_view view( short_example_data, sizeof( short_example_data ), json5::snapshot_view::trusted );
+	return view;
+}
@@ -1,13 +1,28 @@
 #include <json5/json5.hpp>
+#include <json5/json5_binary.hpp>
+#include <json5/json5_compact.hpp>
+#include <json5/json5_editor.hpp>
 #include <json5/json5_input.hpp>
 #include <json5/json5_output.hpp>
+#include <json5/json5_patch.hpp>
+#include <json5/json5_pointer.hpp>
+#include <json5/json5_pool.hpp>
 #include <json5/json5_reflect.hpp>
+#include <json5/json5_shared.hpp>
+#include <json5/json5_stats.hpp>
+#include <json5/json5_transcode.hpp>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <map>
+#include <memory_resource>
+#include <sstream>
 #include <type_traits>
 
+// Generated with: embed short_example.json5 short_example.hpp short_example
+#include "short_example.hpp"
+
 //---------------------------------------------------------------------------------------------------------------------
 struct Stopwatch
 {
@@ -21,6 +36,25 @@ struct Stopwatch
 	}
 };
 
+//---------------------------------------------------------------------------------------------------------------------
+// Memory resource counting allocations passed on to 'upstream'
+struct CountingResource final : std::pmr::memory_resource
+{
+	std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+	std::atomic<size_t> allocations = 0;
+	std::atomic<size_t> bytes = 0;
+
+	void *do_allocate( size_t size, size_t alignment ) override
+	{
+		++allocations;
+		bytes += size;
+		return upstream->allocate( size, alignment );
+	}
+
+	void do_deallocate( void *ptr, size_t size, size_t alignment ) override { upstream->deallocate( ptr, size, alignment ); }
+	bool do_is_equal( const std::pmr::memory_resource &other ) const noexcept override { return this == &other; }
+};
+
 //---------------------------------------------------------------------------------------------------------------------
 bool PrintError( const json5::error &err )
 {
@@ -84,6 +118,31 @@ int main( int argc, char *argv[] )
 		std::cout << json5::to_string( doc );
 	}
 
+	/// Bulk builder APIs
+	{
+		json5::document doc, expected;
+		json5::builder b( doc );
+		const double numbers[] = { 1.0, 2.5, -3.0 };
+
+		b.push_array( 4 );
+		{
+			b.add_numbers( numbers, 3 );
+			b.add_string( "four" );
+
+			b.push_array( 2 );
+			b.add_numbers( numbers, 2 );
+			b += b.pop();
+
+			b.push_object();
+			b["x"] = 1.0;
+			b += b.pop();
+		}
+		b.pop();
+
+		PrintError( json5::from_string( "[ 1, 2.5, -3, 'four', [ 1, 2.5 ], { x: 1 } ]", expected ) );
+		std::cout << ( doc == expected ? "bulk build ok" : "bulk build failed" ) << std::endl;
+	}
+
 	/// Load from file
 	{
 		json5::document doc;
@@ -91,6 +150,38 @@ int main( int argc, char *argv[] )
 		json5::to_stream( std::cout, doc );
 	}
 
+	/// Load from file in blocks
+	{
+		// Error positions stay exact, when the input spans several blocks
+		std::string str = "[\n";
+		while ( str.size() < 3 * json5::detail::file_source::block_size )
+			str += "  'some text', 1234.5,\n";
+		str += "  broken\n]";
+
+		{
+			std::ofstream ofs( "blocks.json5" );
+			ofs << str;
+		}
+
+		json5::document doc1;
+		json5::document doc2;
+		const json5::error err1 = json5::from_file( "blocks.json5", doc1 );
+		const json5::error err2 = json5::from_string( str, doc2 );
+		std::cout << ( err1 && err1.type == err2.type && err1.line == err2.line && err1.column == err2.column
+			? "block errors ok" : "block errors differ" ) << std::endl;
+
+		str.replace( str.rfind( "broken" ), 6, "'fixed'" );
+		{
+			std::ofstream ofs( "blocks.json5" );
+			ofs << str;
+		}
+
+		PrintError( json5::from_file( "blocks.json5", doc1 ) );
+		PrintError( json5::from_string( str, doc2 ) );
+		std::cout << ( doc1 == doc2 ? "block load ok" : "block load failed" ) << std::endl;
+		std::remove( "blocks.json5" );
+	}
+
 	/// File load/save test
 	{
 		json5::document doc1;
@@ -120,6 +211,113 @@ int main( int argc, char *argv[] )
 			else
 				std::cout << "doc1 != doc2" << std::endl;
 		}
+
+		if ( json5::hash( doc1 ) == json5::hash( doc2 ) )
+			std::cout << "hash(doc1) == hash(doc2)" << std::endl;
+		else
+			std::cout << "hash(doc1) != hash(doc2)" << std::endl;
+	}
+
+	/// Document copy and move
+	{
+		json5::document doc1;
+		PrintError( json5::from_file( "twitter.json", doc1 ) );
+
+		json5::document doc2 = doc1;
+		json5::document doc3;
+		{
+			Stopwatch sw{ "Move twitter.json document" };
+			doc3 = std::move( doc1 );
+		}
+
+		doc1 = json5::document();
+		std::cout << ( doc2 == doc3 ? "copy == move" : "copy != move" ) << std::endl;
+
+		// Small string buffer (might be stored inside std::string itself)
+		json5::document small1;
+		{
+			json5::builder b( small1 );
+			b.push_array();
+			b += b.new_string( "a" );
+			b.pop();
+		}
+
+		json5::document small2 = std::move( small1 );
+		std::cout << "small: " << small2[0].get_c_str() << std::endl;
+	}
+
+	/// Binary snapshot
+	{
+		json5::document doc1;
+		PrintError( json5::from_file( "twitter.json", doc1 ) );
+
+		{
+			Stopwatch sw{ "Save twitter.j5b" };
+			json5::to_binary_file( "twitter.j5b", doc1 );
+		}
+
+		json5::document doc2;
+		{
+			Stopwatch sw{ "Load twitter.j5b (doc2)" };
+			PrintError( json5::from_binary_file( "twitter.j5b", doc2 ) );
+		}
+
+		json5::mapped_file file;
+		json5::snapshot_view view;
+		{
+			Stopwatch sw{ "Map twitter.j5b (view)" };
+			file.open( "twitter.j5b" );
+			PrintError( view.assign( file.data(), file.size() ) );
+		}
+
+		if ( doc1 == doc2 && doc1 == view )
+			std::cout << "doc1 == doc2 == view" << std::endl;
+		else
+			std::cout << "doc1 != doc2 != view" << std::endl;
+
+		// Strings and containers with corrupted offsets (payload out of bounds) are rejected
+		json5::document small;
+		PrintError( json5::from_string( "{ text: 'hello', list: [ 1, 'two', { x: 3 } ] }", small ) );
+		const std::string bin = json5::to_binary( small );
+
+		size_t corrupted = 0, rejected = 0;
+		for ( size_t offset = 48; offset + 8 <= bin.size(); offset += 8 )
+		{
+			std::vector<uint64_t> data( ( bin.size() + 7 ) / 8 );
+			memcpy( data.data(), bin.data(), bin.size() );
+
+			uint64_t &slot = data[offset / 8];
+			if ( const auto tag = slot >> 48; tag != 0xFFF2 && tag != 0xFFF4 && tag != 0xFFF6 )
+				continue;
+
+			slot |= 0x0000FFFFFFFFFFFFull;
+			++corrupted;
+
+			json5::document doc;
+			if ( json5::from_binary( data.data(), bin.size(), doc ) && json5::snapshot_view().assign( data.data(), bin.size() ) )
+				++rejected;
+		}
+
+		std::cout << ( corrupted && rejected == corrupted ? "corrupted snapshots rejected" : "corrupted snapshot accepted" ) << std::endl;
+
+		// Trusted snapshots (e.g. embedded ones) are not validated, so the view does not allocate
+		static_assert( noexcept( json5::snapshot_view( nullptr, 0, json5::snapshot_view::trusted ) ) );
+		std::vector<uint64_t> aligned( ( bin.size() + 7 ) / 8 );
+		memcpy( aligned.data(), bin.data(), bin.size() );
+		std::cout << ( json5::snapshot_view( aligned.data(), bin.size(), json5::snapshot_view::trusted ) == small ? "trusted view == source" : "trusted view != source" ) << std::endl;
+	}
+
+	/// Embedded document
+	{
+		json5::document doc;
+		PrintError( json5::from_file( "short_example.json5", doc ) );
+
+		if ( doc == short_example() )
+			std::cout << "doc == embedded" << std::endl;
+		else
+			std::cout << "doc != embedded" << std::endl;
+
+		std::cout << json5::object_view( short_example() )["unquoted"].get_c_str() << std::endl;
 	}
 
 	/// Equality test
@@ -134,6 +332,507 @@ int main( int argc, char *argv[] )
 			std::cout << "doc1 == doc2" << std::endl;
 		else
 			std::cout << "doc1 != doc2" << std::endl;
+
+		json5::document doc3;
+		json5::from_string( "{ z: 3, x: 2, y: 1 }", doc3 );
+
+		if ( json5::hash( doc1 ) == json5::hash( doc2 ) && json5::hash( doc1 ) != json5::hash( doc3 ) )
+			std::cout << "hash(doc1) == hash(doc2) != hash(doc3)" << std::endl;
+		else
+			std::cout << "structural hash failed" << std::endl;
+
+		// Duplicate keys compare as multisets of key-value pairs, in both directions
+		json5::document dup1, dup2, dup3, dup4;
+		PrintError( json5::from_string( "{ a: 1, a: 1, b: 2 }", dup1 ) );
+		PrintError( json5::from_string( "{ a: 1, b: 2, c: 3 }", dup2 ) );
+		PrintError( json5::from_string( "{ a: 2, b: 2, a: 1 }", dup3 ) );
+		PrintError( json5::from_string( "{ b: 2, a: 1, a: 2 }", dup4 ) );
+
+		if ( dup1 != dup2 && dup2 != dup1 && dup1 != dup3 && dup3 != dup1 && dup3 == dup4 && dup4 == dup3 )
+			std::cout << "duplicate keys compared" << std::endl;
+		else
+			std::cout << "duplicate keys compare failed" << std::endl;
+	}
+
+	/// Embedded '\0' in strings
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "{ text: 'a\\0b' }", doc ) );
+		std::cout << "length: " << doc["text"].get_string_view().size() << std::endl;
+		json5::to_stream( std::cout, doc );
+	}
+
+	/// Array iterators
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "[ 1, 'two', 3, { x: 4 }, 5 ]", doc ) );
+
+		const json5::array_view av( doc );
+		const auto numbers = std::count_if( av.begin(), av.end(), []( const json5::value &v ) { return v.is_number(); } );
+		const auto object = std::find_if( av.begin(), av.end(), []( const json5::value &v ) { return v.is_object(); } );
+
+		if ( numbers == 3 && object - av.begin() == 3 && ( *object )["x"] == 4 && av.begin()[1].get_string_view() == "two" &&
+		     ( av.end() - 1 )->get<int>() == 5 && std::distance( av.begin(), av.end() ) == 5 )
+			std::cout << "array iterators ok" << std::endl;
+		else
+			std::cout << "array iterators failed" << std::endl;
+	}
+
+	/// Large object lookup (hash index)
+	{
+		json5::document doc;
+		json5::builder b( doc );
+
+		b.push_object();
+		for ( int i = 0; i < 1000; ++i )
+			b["key" + std::to_string( i )] = double( i );
+		b.pop();
+
+		bool allFound = true;
+		for ( int i = 0; i < 1000; ++i )
+			allFound &= doc["key" + std::to_string( i )].get<int>( -1 ) == i;
+
+		allFound &= doc["missing"].is_null();
+		std::cout << ( allFound ? "all keys found" : "key lookup failed" ) << std::endl;
+	}
+
+	/// Cached key lookups
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "[ { id: 1, user: { id: 10 } }, { id: 2, user: { id: 20 } }, { user: { id: 30 }, id: 3 }, { id: 4 } ]", doc ) );
+
+		const json5::key id( "id" ), user( "user" );
+		int sum = 0;
+
+		for ( auto rec : json5::array_view( doc ) )
+			sum += rec[id].get<int>() + rec[user][id].get<int>();
+
+		std::cout << ( sum == 70 ? "cached keys found" : "cached key lookup failed" ) << std::endl;
+
+		// With duplicate keys, cached lookups find the first match as lookups by string do (small
+		// objects and large ones with hash index, in parsed, imported and edited documents)
+		std::string large = "{ a: 1, a: 2";
+		for ( int i = 0; i < 20; ++i )
+			large += ", k" + std::to_string( i ) + ": " + std::to_string( i );
+
+		json5::document dup, imported;
+		PrintError( json5::from_string( "[ { b: 0, a: 1 }, { a: 2, a: 3 }, " + large + ", a: 3 } ]", dup ) );
+		json5::builder( imported ).import( dup );
+
+		bool isFirst = true;
+		for ( const json5::document *d : { &dup, &imported } )
+		{
+			const json5::key a( "a" );
+			for ( auto rec : json5::array_view( *d ) )
+				isFirst &= rec[a] == rec["a"] && rec[a] == ( *json5::object_view( rec ).find( "a" ) ).second;
+		}
+
+		json5::editor( dup ).set( dup[0], "c", 4 );
+		const json5::key a( "a" );
+		for ( auto rec : json5::array_view( dup ) )
+			isFirst &= rec[a] == rec["a"];
+
+		std::cout << ( isFirst && dup[1][a].get<int>() == 2 && dup[2][a].get<int>() == 1 ? "duplicate keys found first" : "duplicate keys found later" ) << std::endl;
+	}
+
+	/// JSON pointer and compiled paths
+	{
+		json5::document list;
+		PrintError( json5::from_string( "[ 2, { x: 3 } ]", list ) );
+
+		json5::document doc;
+		json5::builder b( doc );
+
+		b.push_object();
+		b["a/b"] = 1.0;
+		b["m~n"] = 2.0;
+		b["list"] = b.import( list );
+		b.pop();
+
+		json5::pointer path;
+		PrintError( path.assign_path( "list[1].x" ) );
+
+		const json5::pointer pointers[] = { json5::pointer( "/a~1b" ), json5::pointer( "/m~0n" ), json5::pointer( "/list/1/x" ), json5::pointer( "/list/01" ) };
+		json5::value results[4];
+		json5::resolve( doc, pointers, 4, results );
+
+		if ( results[0] == 1.0 && results[1] == 2.0 && results[2] == 3.0 && results[3].is_null() && path.resolve( doc ) == results[2] )
+			std::cout << "pointers resolved" << std::endl;
+		else
+			std::cout << "pointer lookup failed" << std::endl;
+
+		// Compiled pointers are shared by threads, which resolve them in objects of different layouts
+		json5::document layouts;
+		PrintError( json5::from_string( "[ { list: [ 0, { x: 1 } ], y: 0 }, { y: 0, z: 0, list: [ 0, { z: 0, x: 2 } ] } ]", layouts ) );
+
+		std::atomic<int> failed = 0;
+		std::vector<std::thread> threads;
+
+		for ( int t = 0; t < 4; ++t )
+		{
+			threads.emplace_back( [&path, &layouts, &failed, t]()
+			{
+				for ( int i = 0; i < 10000; ++i )
+					failed += path.resolve( layouts[size_t( ( i + t ) % 2 )] ).get<int>() != ( i + t ) % 2 + 1;
+			} );
+		}
+
+		for ( auto &t : threads )
+			t.join();
+
+		std::cout << ( failed == 0 ? "shared pointers resolved" : "shared pointer lookup failed" ) << std::endl;
+	}
+
+	/// Shared document publishing
+	{
+		json5::document config;
+		PrintError( json5::from_string( "{ version: 0, items: [ 0, 0 ] }", config ) );
+
+		json5::atomic_shared_document current( json5::shared_document( std::move( config ) ) );
+		std::atomic<bool> consistent = true;
+
+		std::vector<std::thread> readers;
+		for ( int i = 0; i < 4; ++i )
+		{
+			readers.emplace_back( [&current, &consistent]()
+			{
+				for ( int j = 0; j < 1000; ++j )
+				{
+					const auto doc = current.load();
+					const int version = ( *doc )["version"].get<int>();
+
+					for ( auto item : json5::array_view( ( *doc )["items"] ) )
+						if ( item.get<int>() != version )
+							consistent = false;
+				}
+			} );
+		}
+
+		for ( int version = 1; version <= 100; ++version )
+		{
+			json5::document next;
+			const std::string str = std::to_string( version );
+			PrintError( json5::from_string( "{ version: " + str + ", items: [ " + str + ", " + str + " ] }", next ) );
+			current.publish( std::move( next ) );
+		}
+
+		for ( auto &reader : readers )
+			reader.join();
+
+		const auto last = current.load();
+		const bool latest = ( *last )["version"].get<int>() == 100 && last.use_count() == 2;
+		std::cout << ( consistent && latest ? "shared reads consistent" : "shared reads inconsistent" ) << std::endl;
+	}
+
+	/// Memory statistics
+	{
+		const std::string_view input = "{ a: [ 1, 'x', { b: 'x' } ], c: null }";
+
+		json5::document doc;
+		PrintError( json5::from_string( input, doc ) );
+
+		const auto st = json5::stats( doc );
+		std::cout << "depth: " << st.max_depth << ", strings: " << st.count( json5::value_type::string ) << ", keys: " << st.keys;
+		std::cout << ", used: " << st.used_bytes() << ", estimated: " << json5::estimate_footprint( input ) << std::endl;
+
+		// Buffers reserved for parsing are released once the document is complete
+		if ( st.value_reserved_bytes == st.value_bytes )
+			std::cout << "no values reserved after parsing" << std::endl;
+		else
+			std::cout << "values reserved after parsing" << std::endl;
+	}
+
+	/// Compact document
+	{
+		json5::document doc1;
+		PrintError( json5::from_file( "twitter.json", doc1 ) );
+
+		json5::compact_document compact;
+		PrintError( compact.assign( doc1 ) );
+
+		json5::document doc2;
+		compact.unpack( doc2 );
+
+		json5::document doc3;
+		PrintError( json5::from_string( "[ -0, 0.1, 0.5, -3, 268435456, 1e300, 'a\\0b', null, true, {} ]", doc3 ) );
+
+		json5::document doc4;
+		json5::compact_document( doc3 ).unpack( doc4 );
+
+		if ( doc1 == doc2 && doc3 == doc4 && std::signbit( doc4[0].get<double>() ) && compact.reserved_bytes() < doc1.reserved_bytes() )
+			std::cout << "compact == source" << std::endl;
+		else
+			std::cout << "compact != source" << std::endl;
+	}
+
+	/// Compact document shapes
+	{
+		// Records with the same keys share one shape, records with their own keys do not
+		std::string shared = "[", unique = "[";
+		for ( int i = 0; i < 1000; ++i )
+		{
+			const std::string n = std::to_string( i );
+			shared += "{ id: " + n + ", name: 'user', active: true },";
+			unique += "{ id" + n + ": " + n + ", name" + n + ": 'user', active" + n + ": true },";
+		}
+
+		json5::document sharedDoc, uniqueDoc, unpacked;
+		PrintError( json5::from_string( shared + "]", sharedDoc ) );
+		PrintError( json5::from_string( unique + "]", uniqueDoc ) );
+
+		const json5::compact_document sharedCompact( sharedDoc ), uniqueCompact( uniqueDoc );
+		sharedCompact.unpack( unpacked );
+
+		// Shared shapes store keys once, for the packed and unpacked document
+		const auto root = sharedCompact.root();
+		bool isShared = unpacked == sharedDoc && root[0].key( 2 ) == "active" && root[0].key( 0 ).data() == root[999].key( 0 ).data();
+		isShared &= ( *json5::object_view( unpacked[0] ).begin() ).first == ( *json5::object_view( unpacked[999] ).begin() ).first;
+
+		// Each record with its own shape takes at least 4 more slots (key count and keys) and its key strings
+		isShared &= sharedCompact.reserved_bytes() + 1000 * 4 * sizeof( uint32_t ) < uniqueCompact.reserved_bytes();
+		isShared &= sharedCompact.reserved_bytes() < sharedDoc.reserved_bytes() / 2;
+		std::cout << ( isShared ? "compact shapes shared" : "compact shapes not shared" ) << std::endl;
+	}
+
+	/// Compact document views
+	{
+		json5::document doc;
+		PrintError( json5::from_file( "twitter.json", doc ) );
+		const json5::compact_document compact( doc );
+
+		// Values are read in place, without unpacking the document
+		const auto statuses = compact.root()["statuses"];
+		bool isSame = statuses.is_array() && statuses.size() == json5::array_view( doc["statuses"] ).size();
+
+		for ( size_t i = 0; i < statuses.size(); ++i )
+		{
+			const auto status = statuses[i], user = status["user"];
+			isSame &= status["id"].get<double>() == doc["statuses"][i]["id"].get<double>();
+			isSame &= user["screen_name"].get_string_view() == doc["statuses"][i]["user"]["screen_name"].get_string_view();
+			isSame &= user["verified"].get_bool( true ) == doc["statuses"][i]["user"]["verified"].get_bool( true );
+			isSame &= status["missing"].is_null() && user.size() == json5::object_view( doc["statuses"][i]["user"] ).size();
+		}
+
+		json5::document mixed;
+		PrintError( json5::from_string( "{ a: -0, b: 0.1, c: 0.5, d: 'x\\0y', e: null, f: [ true, {} ], a: 1 }", mixed ) );
+
+		const json5::compact_document compactMixed( mixed );
+		const auto root = compactMixed.root();
+		isSame &= std::signbit( root["a"].get<double>( 1.0 ) ) && root["b"].get<double>() == 0.1 && root["c"].get<float>() == 0.5f;
+		isSame &= root["d"].get_string_view() == std::string_view( "x\0y", 3 ) && root["e"].is_null() && root["f"][0].get_bool();
+		isSame &= root["f"][1].is_object() && root["f"][1].size() == 0 && root["f"][2].is_null() && root.key( 6 ) == "a" && root[6].get<int>() == 1;
+		std::cout << ( isSame ? "compact views == source" : "compact views != source" ) << std::endl;
+	}
+
+	/// Import subtrees from other documents
+	{
+		json5::document src;
+		PrintError( json5::from_string( "{ user: { name: 'test', tags: [ 'a', 'b' ] }, items: [ 1, { x: 2 } ] }", src ) );
+
+		json5::document doc;
+		json5::builder b( doc );
+		b.push_object();
+		b["owner"] = b.import( src["user"] );
+		b["items"] = b.import( src["items"] );
+		b["all"] = b.import( src );
+		b.pop();
+
+		// Array referenced by two keys
+		json5::document shared;
+		{
+			json5::builder sb( shared );
+			sb.push_object();
+			sb.push_array();
+			sb += sb.new_string( "item" );
+			const auto arr = sb.pop();
+			sb["first"] = arr;
+			sb["second"] = arr;
+			sb.pop();
+		}
+
+		json5::document sharedCopy;
+		{
+			json5::builder sb( sharedCopy );
+			sb.push_array();
+			sb += sb.new_string( "padding" );
+			sb += sb.import( shared );
+			sb.pop();
+		}
+
+		json5::to_stream( std::cout, doc );
+		std::cout << ( doc["owner"] == src["user"] && doc["all"] == src && json5::hash( doc["all"] ) == json5::hash( src ) && sharedCopy[1] == shared ? "import == source" : "import != source" ) << std::endl;
+	}
+
+	/// Merge documents built on separate threads
+	{
+		json5::document parts[4];
+		std::vector<std::thread> threads;
+
+		for ( size_t i = 0; i < 4; ++i )
+		{
+			threads.emplace_back( [&parts, i]
+			{
+				json5::builder b( parts[i] );
+				b.push_object();
+				b["shard"] = double( i );
+				b["name"] = b.new_string( "shard" + std::to_string( i ) );
+				b.push_array();
+				b += b.new_string( "x" );
+				const auto items = b.pop();
+				b["items"] = items;
+				b["alias"] = items;
+				b.pop();
+			} );
+		}
+
+		for ( auto &t : threads )
+			t.join();
+
+		json5::document doc;
+		json5::builder b( doc );
+		b.push_array( 4 );
+
+		for ( const auto &part : parts )
+			b += b.merge( part );
+
+		b.pop();
+
+		json5::writer_params wp;
+		wp.compact = true;
+
+		std::cout << json5::to_string( doc, wp ) << std::endl;
+		std::cout << ( doc[3] == parts[3] && json5::hash( doc[0] ) == json5::hash( parts[0] ) ? "merge == parts" : "merge != parts" ) << std::endl;
+	}
+
+	/// In-place editing
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "{ name: 'test', list: [ 1, 2, 3 ], remove: true }", doc ) );
+
+		json5::editor e( doc );
+		e.set( doc, "name", e.new_string( "edited" ) );
+		e.erase( doc, "remove" );
+		e.erase( doc["list"], 0 );
+		e.insert( doc["list"], 0, 0 );
+
+		for ( int i = 4; i < 100; ++i )
+			e.push_back( doc["list"], i );
+
+		e.set( doc, "nested", json5::editor::empty_object() );
+		for ( int i = 0; i < 100; ++i )
+			e.set( doc["nested"], "key" + std::to_string( i ), i );
+
+		e.set( doc["nested"], "copy", doc["list"] );
+
+		bool allFound = json5::array_view( doc["list"] ).size() == 99 && doc["nested"]["copy"] == doc["list"];
+		for ( int i = 0; i < 100; ++i )
+			allFound &= doc["nested"]["key" + std::to_string( i )].get<int>( -1 ) == i;
+
+		json5::document expected;
+		PrintError( json5::from_string( json5::to_string( doc ), expected ) );
+
+		const uint64_t editedHash = json5::hash( doc );
+		e.compact();
+
+		allFound &= doc == expected && json5::hash( doc ) == editedHash && json5::hash( doc ) == json5::hash( expected );
+
+		// Copy of an object with a moved array must not share elements with the original
+		e.push_back( doc["nested"]["copy"], 99 );
+		e.set( doc, "copy", doc["nested"] );
+		e.push_back( doc["copy"]["copy"], 100 );
+		e.compact();
+
+		allFound &= json5::array_view( doc["nested"]["copy"] ).size() == 100 && json5::array_view( doc["copy"]["copy"] ).size() == 101;
+		std::cout << ( allFound ? "edits applied" : "edits failed" ) << std::endl;
+	}
+
+	/// Capacity of edited containers
+	{
+		// Moved containers keep their capacity in the document, so growing the root and a nested
+		// array through a new editor per element still takes amortized O(1) value slots
+		json5::document doc;
+		PrintError( json5::from_string( "{ list: [] }", doc ) );
+
+		for ( int i = 0; i < 1000; ++i )
+		{
+			json5::editor e( doc );
+			e.push_back( doc["list"], i );
+			e.set( doc, "key" + std::to_string( i ), i );
+		}
+
+		bool isAmortized = json5::stats( doc ).value_bytes < 4 * 3000 * sizeof( json5::value );
+		isAmortized &= json5::array_view( doc["list"] ).size() == 1000 && json5::object_view( doc ).size() == 1001 && doc["key999"].get<int>() == 999;
+		std::cout << ( isAmortized ? "editor capacity kept" : "editor capacity lost" ) << std::endl;
+	}
+
+	/// Pre-order and breadth-first layout
+	{
+		json5::document src;
+		PrintError( json5::from_file( "twitter.json", src ) );
+
+		json5::document pre = src, bfs = src;
+		json5::editor( pre ).compact( json5::layout::pre_order );
+		json5::editor( bfs ).compact( json5::layout::breadth_first );
+
+		json5::document sub, subCopy;
+		json5::builder( sub ).import( pre["statuses"][1] );
+		json5::builder( subCopy ).import( sub["user"] );
+
+		json5::document post = pre;
+		json5::editor( post ).compact();
+
+		const bool layoutsKept = pre.has_layout( json5::layout::pre_order ) && bfs.has_layout( json5::layout::breadth_first ) &&
+		                         sub.has_layout( json5::layout::pre_order ) && !sub.has_layout( json5::layout::post_order ) &&
+		                         post.has_layout( json5::layout::post_order ) && src.has_layout( json5::layout::post_order );
+
+		if ( pre == src && bfs == src && post == src && json5::to_string( pre ) == json5::to_string( src ) && sub == src["statuses"][1] && subCopy == src["statuses"][1]["user"] && layoutsKept )
+			std::cout << "relayout == source" << std::endl;
+		else
+			std::cout << "relayout != source" << std::endl;
+	}
+
+	/// Merge patch and JSON patch
+	{
+		json5::document doc, patch, expected;
+		PrintError( json5::from_string( "{ title: 'Goodbye!', author: { givenName: 'John', familyName: 'Doe' }, tags: [ 'example', 'sample' ] }", doc ) );
+
+		PrintError( json5::from_string( "{ title: 'Hello!', phoneNumber: '+01-123-456-7890', author: { familyName: null }, tags: [ 'example' ] }", patch ) );
+		PrintError( json5::apply_merge_patch( doc, patch ) );
+
+		PrintError( json5::from_string( "[ { op: 'add', path: '/tags/-', value: 'patched' }, { op: 'move', from: '/phoneNumber', path: '/author/phone' },"
+		                                 "  { op: 'test', path: '/author/givenName', value: 'John' }, { op: 'remove', path: '/tags/0' } ]", patch ) );
+		PrintError( json5::apply_patch( doc, patch ) );
+
+		PrintError( json5::from_string( "{ title: 'Hello!', author: { givenName: 'John', phone: '+01-123-456-7890' }, tags: [ 'patched' ] }", expected ) );
+		std::cout << ( doc == expected ? "patches applied" : "patches failed" ) << std::endl;
+
+		PrintError( json5::from_string( "[ { op: 'test', path: '/title', value: 'Hello!' }, { op: 'test', path: '/title', value: 'Goodbye!' } ]", patch ) );
+		const json5::error err = json5::apply_patch( doc, patch );
+		std::cout << ( err.type == json5::error::test_failed && err.operation == 1 ? "failed test reported" : "failed test not reported" ) << std::endl;
+		PrintError( err );
+
+		// Containers grown by earlier patches keep their capacity
+		for ( int i = 0; i < 1000; ++i )
+		{
+			PrintError( json5::from_string( "[ { op: 'add', path: '/tags/-', value: 'tag' }, { op: 'add', path: '/count" + std::to_string( i ) + "', value: 0 } ]", patch ) );
+			PrintError( json5::apply_patch( doc, patch ) );
+		}
+
+		const bool isAmortized = json5::stats( doc ).value_bytes < 8 * 3000 * sizeof( json5::value ) && json5::array_view( doc["tags"] ).size() == 1001;
+		std::cout << ( isAmortized ? "patch capacity kept" : "patch capacity lost" ) << std::endl;
+	}
+
+	/// Structural diff
+	{
+		json5::document doc1, doc2;
+		PrintError( json5::from_string( "{ name: 'a', list: [ 1, 2, 3, 4 ], nested: { x: 1, y: [ true ] }, old: null }", doc1 ) );
+		PrintError( json5::from_string( "{ name: 'b', list: [ 1, 3, 4, 5 ], nested: { x: 1, y: [ false ] }, new: {} }", doc2 ) );
+
+		auto patch = json5::diff( doc1, doc2 );
+		json5::to_stream( std::cout, patch );
+
+		PrintError( json5::apply_patch( doc1, patch ) );
+		std::cout << ( doc1 == doc2 && json5::array_view( json5::diff( doc1, doc2 ) ).empty() ? "diff applied" : "diff failed" ) << std::endl;
 	}
 
 	/// String line breaks
@@ -143,6 +842,59 @@ int main( int argc, char *argv[] )
 		json5::to_stream( std::cout, doc );
 	}
 
+	/// Stream output of values and strings
+	{
+		json5::document doc, sub;
+		PrintError( json5::from_string( "{ list: [ 1, 'two', { x: 3 } ] }", doc ) );
+		PrintError( json5::from_string( "[ 1, 'two', { x: 3 } ]", sub ) );
+
+		json5::writer_params wp;
+		wp.compact = true;
+
+		std::ostringstream os;
+		json5::to_stream( os, doc["list"], wp, 0 );
+		os << ' ';
+		json5::to_stream( os, "quote \" and tab \t", '"', false );
+
+		std::cout << ( os.str() == json5::to_string( sub, wp ) + " \"quote \\\" and tab \\t\"" ? "value streams ok" : "value streams failed" ) << std::endl;
+	}
+
+	/// Number output (integers out of int64 range)
+	{
+		json5::document doc;
+		PrintError( json5::from_string( "[ 123, -4.5, 1e300, -1e19, 9007199254740992 ]", doc ) );
+		json5::writer_params wp;
+		wp.compact = true;
+		std::cout << json5::to_string( doc, wp ) << std::endl;
+	}
+
+	/// Transcode without building a document
+	{
+		json5::writer_params wp;
+		wp.json_compatible = true;
+
+		std::ifstream ifs( "short_example.json5" );
+		PrintError( json5::transcode( ifs, std::cout, wp ) );
+
+		std::ifstream ifs2( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs2 ) ), std::istreambuf_iterator<char>() );
+
+		wp.compact = true;
+		std::string out;
+		{
+			Stopwatch sw{ "Transcode twitter.json" };
+			PrintError( json5::transcode( str, out, wp ) );
+		}
+
+		json5::document doc;
+		json5::from_string( str, doc );
+
+		if ( out == json5::to_string( doc, wp ) )
+			std::cout << "transcode == to_string" << std::endl;
+		else
+			std::cout << "transcode != to_string" << std::endl;
+	}
+
 	/// Reflection test
 	{
 		struct Foo
@@ -177,6 +929,106 @@ int main( int argc, char *argv[] )
 		*/
 	}
 
+	/// Memory resources
+	{
+		const std::string_view input = "{ text: 'hello', list: [ 1, 2, { x: 'three' } ] }";
+
+		// Documents and builders allocate only from the supplied resource
+		CountingResource counter, defaultCounter;
+		std::pmr::memory_resource *prevDefault = std::pmr::set_default_resource( &defaultCounter );
+		{
+			std::pmr::monotonic_buffer_resource arena( &counter );
+			json5::document doc( &arena );
+			PrintError( json5::from_string( input, doc ) );
+
+			// Move between resources copies the buffers, the target keeps its resource
+			json5::document other( std::pmr::new_delete_resource() );
+			other = std::move( doc );
+
+			if ( counter.allocations > 0 && defaultCounter.allocations == 0 && doc.is_null() &&
+			     other.resource() == std::pmr::new_delete_resource() && other["list"][2]["x"].get_string_view() == "three" )
+				std::cout << "documents allocate from their resource" << std::endl;
+			else
+				std::cout << "documents allocate from other resources" << std::endl;
+		}
+
+		std::pmr::set_default_resource( prevDefault );
+	}
+
+	/// Document pool
+	{
+		std::ifstream ifs( "twitter.json" );
+		const std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+
+		// Parsing into a recycled document reuses its buffers, only builder scratch is allocated
+		CountingResource counter;
+		json5::document_pool pool( 4, 16 * 1024 * 1024, &counter );
+		PrintError( json5::from_string( str, *pool.acquire() ) );
+
+		const size_t allocatedBytes = counter.bytes;
+		{
+			auto doc = pool.acquire();
+			PrintError( json5::from_string( str, *doc ) );
+			std::cout << ( counter.bytes - allocatedBytes < doc->reserved_bytes() / 100 ? "pooled re-parse reuses buffers" : "pooled re-parse allocates buffers" ) << std::endl;
+		}
+
+		// Released documents are recycled, until the pool caches 'maxCachedDocuments' of them
+		json5::document *first = nullptr;
+		{
+			auto doc = pool.acquire();
+			first = doc.get();
+		}
+
+		bool isPooled = pool.acquire().get() == first;
+		{
+			std::vector<json5::document_pool::handle> handles;
+			for ( int i = 0; i < 16; ++i )
+				handles.push_back( pool.acquire() );
+		}
+
+		isPooled &= pool.size() == 4;
+
+		// Documents reserving more than 'maxRetainedBytes' are trimmed on release
+		json5::document_pool smallPool( 4, 64 * 1024, &counter );
+		{
+			auto doc = smallPool.acquire();
+			PrintError( json5::from_string( str, *doc ) );
+		}
+
+		isPooled &= smallPool.acquire()->reserved_bytes() < 1024;
+		{
+			auto doc = smallPool.acquire();
+			PrintError( json5::from_string( "{ small: [ 1, 2, 3 ] }", *doc ) );
+		}
+
+		isPooled &= smallPool.acquire()->reserved_bytes() > 0;
+		std::cout << ( isPooled ? "pool recycles and trims documents" : "pool recycling failed" ) << std::endl;
+
+		// Concurrent acquire and release, every document is used by one thread at a time
+		std::atomic<int> failed = 0;
+		std::vector<std::thread> threads;
+
+		for ( int t = 0; t < 8; ++t )
+		{
+			threads.emplace_back( [&pool, &failed, t]()
+			{
+				for ( int i = 0; i < 200; ++i )
+				{
+					const std::string input = "{ thread: " + std::to_string( t ) + ", iteration: " + std::to_string( i ) + " }";
+					auto doc = pool.acquire();
+
+					if ( !doc->is_null() || json5::from_string( input, *doc ) || ( *doc )["thread"].get<int>() != t || ( *doc )["iteration"].get<int>() != i )
+						++failed;
+				}
+			} );
+		}
+
+		for ( auto &t : threads )
+			t.join();
+
+		std::cout << ( failed == 0 && pool.size() <= 4 ? "concurrent pool ok" : "concurrent pool failed" ) << std::endl;
+	}
+
 	/// Performance test
 	{
 		std::ifstream ifs("twitter.json");
@@ -192,5 +1044,53 @@ int main( int argc, char *argv[] )
 		}
 	}
 
+	/// Performance test (output)
+	{
+		json5::document doc;
+		PrintError( json5::from_file( "twitter.json", doc ) );
+
+		std::string str;
+		Stopwatch sw{ "Write twitter.json 100x" };
+
+		for ( int i = 0; i < 100; ++i )
+			json5::to_string( str, doc );
+	}
+
+	/// Performance test (document pool)
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+		json5::document_pool pool( 16, 16 * 1024 * 1024 );
+
+		Stopwatch sw{ "Parse twitter.json 100x (pool)" };
+
+		for ( int i = 0; i < 100; ++i )
+		{
+			auto doc = pool.acquire();
+			if ( auto err = json5::from_string( str, *doc ) )
+				break;
+		}
+	}
+
+	/// Performance test (monotonic arena)
+	{
+		std::ifstream ifs( "twitter.json" );
+		std::string str( ( std::istreambuf_iterator<char>( ifs ) ), std::istreambuf_iterator<char>() );
+		std::pmr::monotonic_buffer_resource arena;
+
+		Stopwatch sw{ "Parse twitter.json 100x (arena)" };
+
+		for ( int i = 0; i < 100; ++i )
+		{
+			{
+				json5::document doc( &arena );
+				if ( auto err = json5::from_string( str, doc ) )
+					break;
+			}
+
+			arena.release();
+		}
+	}
+
 	return 0;
 }
@@ -0,0 +1,39 @@
+#include <json5/json5_binary.hpp>
+#include <json5/json5_input.hpp>
+#include <json5/json5_output.hpp>
+
+#include <iostream>
+
+/*
+	Converts JSON5 file into C++ header with pre-built document data:
+
+	embed <input.json5> <output.hpp> <name>
+
+	The generated header defines 'name()' returning 'const json5::snapshot_view &'. The view is
+	constructed as trusted (only the snapshot header is checked), so it does not allocate.
+*/
+int main( int argc, char *argv[] )
+{
+	if ( argc != 4 )
+	{
+		std::cerr << "usage: embed <input.json5> <output.hpp> <name>" << std::endl;
+		return 1;
+	}
+
+	json5::document doc;
+	if ( auto err = json5::from_file( argv[1], doc ) )
+	{
+		std::cerr << argv[1] << ": " << json5::to_string( err ) << std::endl;
+		return 1;
+	}
+
+	std::ofstream ofs( argv[2] );
+	if ( !ofs.is_open() )
+	{
+		std::cerr << argv[2] << ": could not open" << std::endl;
+		return 1;
+	}
+
+	json5::to_cpp_header( ofs, doc, argv[3] );
+	return ofs.good() ? 0 : 1;
+}